@@ -142,6 +142,13 @@ decode_post()
     url_decode(CGIParameterHandler(), StdinItor(cl), StdinItor());
 }
 
+void
+decode_post(const string& body)
+{
+    cgi_params.clear();
+    url_decode(CGIParameterHandler(), CStringItor(body.c_str()), CStringItor());
+}
+
 void
 decode_get()
 {
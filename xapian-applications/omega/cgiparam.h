@@ -34,6 +34,9 @@ extern void decode_test();
 /* decode the query as a POST */
 extern void decode_post();
 
+/* decode the query from a POST body which has already been read */
+extern void decode_post(const std::string& body);
+
 /* decode the query as a GET */
 extern void decode_get();
 
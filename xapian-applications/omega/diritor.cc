@@ -176,6 +176,22 @@ DirectoryIterator::start(const std::string & path_)
     }
 }
 
+void
+DirectoryIterator::start_entry(const std::string & path_,
+			       const std::string & leafname_)
+{
+    if (dir) {
+	closedir(dir);
+	dir = NULL;
+    }
+    if (fd >= 0) close_fd();
+    path = path_;
+    path_len = path.length();
+    entry = NULL;
+    entry_leafname = leafname_;
+    statbuf_valid = false;
+}
+
 void
 DirectoryIterator::next_failed() const
 {
@@ -73,6 +73,8 @@ class DirectoryIterator {
 
     DIR * dir = NULL;
     struct dirent *entry;
+    /// Leafname of the entry set by start_entry().
+    std::string entry_leafname;
     struct stat statbuf;
     bool statbuf_valid;
     bool follow_symlinks;
@@ -108,6 +110,18 @@ class DirectoryIterator {
     //  Throws a std::string exception upon failure.
     void start(const std::string & path);
 
+    /** Access a single entry in @a path.
+     *
+     *  This allows a file found by iterating in one process to be handled in
+     *  another.
+     *
+     *  @param path_	The directory containing the entry, as passed to
+     *			start().
+     *  @param leafname_	The leafname of the entry.
+     */
+    void start_entry(const std::string & path_,
+		     const std::string & leafname_);
+
     /// Read the next directory entry which doesn't start with ".".
     //
     //  We do this to skip ".", "..", and Unix hidden files.
@@ -128,7 +142,9 @@ class DirectoryIterator {
     [[noreturn]]
     void next_failed() const;
 
-    const char * leafname() const { return entry->d_name; }
+    const char * leafname() const {
+	return entry ? entry->d_name : entry_leafname.c_str();
+    }
 
     const std::string & pathname() const { return path; }
 
@@ -139,7 +155,7 @@ class DirectoryIterator {
 	/* Possible values:
 	 * DT_UNKNOWN DT_FIFO DT_CHR DT_DIR DT_BLK DT_REG DT_LNK DT_SOCK DT_WHT
 	 */
-	switch (entry->d_type) {
+	if (entry) switch (entry->d_type) {
 	    case DT_UNKNOWN:
 		// The current filing system doesn't support d_type.
 		break;
@@ -31,16 +31,20 @@
 #include "index_file.h"
 
 #include <algorithm>
+#include <deque>
 #include <iostream>
 #include <limits>
+#include <sstream>
 #include <string>
 #include <map>
 #include <vector>
 
 #include <sys/types.h>
+#include "safesyswait.h"
 #include "safeunistd.h"
 #include <cassert>
 #include <cerrno>
+#include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -62,6 +66,7 @@
 #include "msxmlparser.h"
 #include "opendocmetaparser.h"
 #include "opendocparser.h"
+#include "parseint.h"
 #include "pkglibbindir.h"
 #include "runfilter.h"
 #include "sample.h"
@@ -72,6 +77,7 @@
 #include "utf8convert.h"
 #include "values.h"
 #include "worker.h"
+#include "worker_comms.h"
 #include "xlsxparser.h"
 #include "xpsparser.h"
 
@@ -91,6 +97,15 @@ static dup_action_type dup_action;
 static bool ignore_exclusions;
 static bool description_as_sample;
 static bool date_terms;
+static bool spelling;
+static bool content_cache;
+
+/** Do we need to keep the content cache entries up to date?
+ *
+ *  True if content_cache is, or if the database has a content cache from an
+ *  earlier run.
+ */
+static bool have_content_cache;
 
 static time_t last_altered_max;
 static size_t sample_size;
@@ -106,6 +121,100 @@ static Failed failed;
 
 map<string, Filter> commands;
 
+/** Should we record the spelling data each document adds?
+ *
+ *  True in an extraction subprocess, which can't update the spelling data
+ *  itself, and with --content-cache so the spelling data can be added again
+ *  when a document is reused.
+ */
+static bool record_spellings;
+
+/** Indexes the text which the indexer adds spelling data for.
+ *
+ *  Only used if record_spellings is true.  TermGenerator adds a spelling
+ *  entry for each word of text indexed without a prefix, whatever the
+ *  stemming strategy, and with STEM_NONE it also adds an unprefixed term for
+ *  each such word, so the wdf of each term in spelling_doc is the frequency
+ *  to add.
+ */
+static Xapian::TermGenerator spelling_indexer;
+
+/// Document spelling_indexer indexes into.
+static Xapian::Document spelling_doc;
+
+#ifdef HAVE_FORK
+/// Number of extraction subprocesses to run.
+static unsigned extract_jobs;
+
+/** Stream to report results to the parent process on.
+ *
+ *  Only set in an extraction subprocess.
+ */
+static FILE* extractor_out = NULL;
+
+/** A long-lived extraction subprocess.
+ *
+ *  Keeping these running means filters with persistent state (such as
+ *  --worker assistants) only get started once per subprocess.
+ */
+struct Extractor {
+    /// The process id, or 0 if the subprocess isn't running.
+    pid_t pid = 0;
+
+    /// Stream to send files to extract on.
+    FILE* out = NULL;
+
+    /// Stream to read results from.
+    FILE* in = NULL;
+};
+
+/// The extraction subprocesses.
+static vector<Extractor> extractors;
+
+/// Indices into extractors of those not busy extracting a file.
+static vector<size_t> idle_extractors;
+
+/// Value of PendingExtraction::extractor for a document which was reused.
+static const size_t NO_EXTRACTOR = size_t(-1);
+
+/** A file being extracted by a subprocess.
+ *
+ *  Or a file whose document was built by reusing one with the same content,
+ *  but which was found after files still being extracted.
+ */
+struct PendingExtraction {
+    /** Index into extractors of the subprocess extracting the file.
+     *
+     *  NO_EXTRACTOR for a reused document.
+     */
+    size_t extractor;
+
+    string urlterm;
+
+    string context;
+
+    time_t last_altered;
+
+    Xapian::docid did;
+
+    off_t size;
+
+    time_t mtime;
+
+    /// Output to show for a reused document.
+    string output;
+
+    /// A reused document.
+    Xapian::Document doc;
+
+    /// The spelling data for a reused document, as for index_add_document().
+    string spellings;
+};
+
+/// Files being extracted, or reused documents, in the order they were found.
+static deque<PendingExtraction> pending_extractions;
+#endif
+
 static void
 mark_as_seen(Xapian::docid did)
 {
@@ -119,7 +228,18 @@ void
 skip(const string& urlterm, const string& context, const string& msg,
      off_t size, time_t last_mod, unsigned flags)
 {
-    failed.add(urlterm, last_mod, size);
+#ifdef HAVE_FORK
+    if (extractor_out) {
+	// The parent process owns the failure log.
+	putc('S', extractor_out);
+	write_string(extractor_out, urlterm);
+	write_unsigned(extractor_out, static_cast<unsigned long>(last_mod));
+	write_unsigned(extractor_out, static_cast<unsigned long>(size));
+    } else
+#endif
+    {
+	failed.add(urlterm, last_mod, size);
+    }
 
     if (!verbose || (flags & SKIP_SHOW_FILENAME)) {
 	if (!verbose && (flags & SKIP_VERBOSE_ONLY)) return;
@@ -136,6 +256,19 @@ skip_cmd_failed(const string& urlterm, const string& context, const string& cmd,
     skip(urlterm, context, "\"" + cmd + "\" failed", size, last_mod);
 }
 
+/// Don't try the filter for @a filter_entry again for this run.
+static void
+disable_filter(const string& filter_entry)
+{
+    commands[filter_entry] = Filter();
+#ifdef HAVE_FORK
+    if (extractor_out) {
+	putc('F', extractor_out);
+	write_string(extractor_out, filter_entry);
+    }
+#endif
+}
+
 static void
 skip_meta_tag(const string& urlterm, const string& context,
 	      off_t size, time_t last_mod)
@@ -403,8 +536,8 @@ index_init(const string& dbpath, const Xapian::Stem& stemmer,
 	   size_t sample_size_, size_t title_size_, size_t max_ext_len_,
 	   bool overwrite, bool retry_failed_,
 	   bool delete_removed_documents, bool verbose_, bool use_ctime_,
-	   bool spelling, bool ignore_exclusions_, bool description_as_sample_,
-	   bool date_terms_)
+	   bool spelling_, bool ignore_exclusions_, bool description_as_sample_,
+	   bool date_terms_, unsigned extract_jobs_, bool content_cache_)
 {
     root = root_;
     site_term = site_term_;
@@ -419,6 +552,13 @@ index_init(const string& dbpath, const Xapian::Stem& stemmer,
     ignore_exclusions = ignore_exclusions_;
     description_as_sample = description_as_sample_;
     date_terms = date_terms_;
+    spelling = spelling_;
+    content_cache = content_cache_;
+#ifdef HAVE_FORK
+    extract_jobs = extract_jobs_;
+#else
+    (void)extract_jobs_;
+#endif
 
     if (!overwrite) {
 	db = Xapian::WritableDatabase(dbpath, Xapian::DB_CREATE_OR_OPEN);
@@ -439,12 +579,21 @@ index_init(const string& dbpath, const Xapian::Stem& stemmer,
     } else {
 	db = Xapian::WritableDatabase(dbpath, Xapian::DB_CREATE_OR_OVERWRITE);
     }
+    have_content_cache =
+	content_cache ||
+	db.metadata_keys_begin("C") != db.metadata_keys_end("C");
 
     if (spelling) {
 	indexer.set_database(db);
 	indexer.set_flags(indexer.FLAG_SPELLING);
+	spelling_indexer.set_stemming_strategy(
+	    Xapian::TermGenerator::STEM_NONE);
+	record_spellings = content_cache;
     }
     indexer.set_stemmer(stemmer);
+    // This indexer is used for every file we index, so the stems of common
+    // words stay cached from one file to the next.
+    indexer.set_stemmer_cache_size(16384);
 
     runfilter_init();
 
@@ -664,20 +813,119 @@ index_remove_failed_entry(const string& urlterm)
     failed.del(urlterm);
 }
 
+/** Key in the user metadata of the content cache entry for a file.
+ *
+ *  The entry's value is a space separated list of the docids of documents
+ *  indexed from files with this content.
+ */
+static string
+content_cache_key(const string& md5, const string& size_value)
+{
+    string key = "C";
+    key += md5;
+    key += size_value;
+    return key;
+}
+
+/** Key in the user metadata of the spelling data for document @a did.
+ *
+ *  The value is a Document serialised with a term for each word which
+ *  indexing the document added to the spelling data, with its frequency as
+ *  the wdf.  It's only recorded for documents with a content cache entry,
+ *  and only with --spelling.
+ */
+static string
+content_cache_spellings_key(Xapian::docid did)
+{
+    return "W" + str(did);
+}
+
+/// Parse the docids in a content cache entry.
+static vector<Xapian::docid>
+parse_content_cache_entry(const string& entry)
+{
+    vector<Xapian::docid> dids;
+    size_t start = 0;
+    while (start < entry.size()) {
+	size_t end = entry.find(' ', start);
+	if (end == string::npos) end = entry.size();
+	Xapian::docid did;
+	if (parse_unsigned(entry.substr(start, end - start).c_str(), did))
+	    dids.push_back(did);
+	start = end + 1;
+    }
+    return dids;
+}
+
+/** Add document @a did to the content cache entry for its content.
+ *
+ *  @param spellings	The spelling data for the document, or an empty string
+ *			if we don't know it.
+ */
+static void
+content_cache_add(Xapian::docid did, const Xapian::Document& doc,
+		  const string& spellings)
+{
+    const string& md5 = doc.get_value(VALUE_MD5);
+    if (md5.empty()) return;
+    string key = content_cache_key(md5, doc.get_value(VALUE_SIZE));
+    string entry = db.get_metadata(key);
+    if (!entry.empty()) entry += ' ';
+    entry += str(did);
+    db.set_metadata(key, entry);
+    if (!spellings.empty())
+	db.set_metadata(content_cache_spellings_key(did), spellings);
+}
+
+/** Remove document @a did from the content cache entry for its content.
+ *
+ *  Called before the document is replaced or deleted.  Once no documents
+ *  with the content are left the entry is deleted.
+ */
+static void
+content_cache_remove(Xapian::docid did)
+{
+    db.set_metadata(content_cache_spellings_key(did), string());
+    Xapian::Document doc;
+    try {
+	doc = db.get_document(did);
+    } catch (const Xapian::DocNotFoundError&) {
+	return;
+    }
+    const string& md5 = doc.get_value(VALUE_MD5);
+    if (md5.empty()) return;
+    string key = content_cache_key(md5, doc.get_value(VALUE_SIZE));
+    string entry;
+    const string& old_entry = db.get_metadata(key);
+    for (Xapian::docid cached_did : parse_content_cache_entry(old_entry)) {
+	if (cached_did == did) continue;
+	if (!entry.empty()) entry += ' ';
+	entry += str(cached_did);
+    }
+    // Setting an empty value deletes the entry.
+    db.set_metadata(key, entry);
+}
+
 void
 index_add_document(const string& urlterm, time_t last_altered,
-		   Xapian::docid did, const Xapian::Document& doc)
+		   Xapian::docid did, const Xapian::Document& doc,
+		   const string& spellings)
 {
     if (dup_action != DUP_SKIP) {
 	// If this document has already been indexed, update the existing
 	// entry.
 	if (did) {
 	    // We already found out the document id above.
+	    if (have_content_cache) content_cache_remove(did);
 	    db.replace_document(did, doc);
 	} else if (last_altered <= last_altered_max) {
 	    // We checked for the UID term and didn't find it.
 	    did = db.add_document(doc);
 	} else {
+	    if (have_content_cache) {
+		Xapian::PostingIterator p = db.postlist_begin(urlterm);
+		if (p != db.postlist_end(urlterm)) content_cache_remove(*p);
+	    }
 	    did = db.replace_document(urlterm, doc);
 	}
 	mark_as_seen(did);
@@ -690,12 +938,695 @@ index_add_document(const string& urlterm, time_t last_altered,
 	}
     } else {
 	// If this were a duplicate, we'd have skipped it above.
-	db.add_document(doc);
+	did = db.add_document(doc);
 	if (verbose)
 	    cout << "added" << endl;
     }
+
+    if (have_content_cache) content_cache_add(did, doc, spellings);
+}
+
+/// Add boolean terms for the directories containing the file.
+static void
+add_path_terms(Xapian::Document& doc, string pathterm)
+{
+    // Use `file` as the basis, as we don't want URL encoding in these terms,
+    // but need to switch over the initial part so we get `/~olly/foo/bar` not
+    // `/home/olly/public_html/foo/bar`.
+    size_t j;
+    while ((j = pathterm.rfind('/')) > 1 && j != string::npos) {
+	pathterm.resize(j);
+	if (pathterm.length() > MAX_SAFE_TERM_LENGTH) {
+	    string term_hash = hash_long_term(pathterm, MAX_SAFE_TERM_LENGTH);
+	    doc.add_boolean_term(term_hash);
+	} else {
+	    doc.add_boolean_term(pathterm);
+	}
+    }
+}
+
+/// Index text without a prefix, which the indexer adds spelling data for.
+static void
+index_unprefixed_text(const string& text)
+{
+    indexer.index_text(text);
+    if (record_spellings)
+	spelling_indexer.index_text_without_positions(text);
+}
+
+/// Prefix of the terms index_leafname() adds.
+static const char LEAFNAME_PREFIX[] = "F";
+
+/// Index the leafname of the file into the indexer's current document.
+static void
+index_leafname(DirectoryIterator& d)
+{
+    indexer.increase_termpos(100);
+    string leaf = d.leafname();
+    string::size_type dot = leaf.find_last_of('.');
+    if (dot != string::npos && leaf.size() - dot - 1 <= max_ext_len)
+	leaf.resize(dot);
+    indexer.index_text(leaf, 1, LEAFNAME_PREFIX);
+
+    // Also index with underscores and ampersands replaced by spaces.
+    bool modified = false;
+    string::size_type rep = 0;
+    while ((rep = leaf.find_first_of("_&", rep)) != string::npos) {
+	leaf[rep++] = ' ';
+	modified = true;
+    }
+    if (modified) {
+	indexer.increase_termpos(100);
+	indexer.index_text(leaf, 1, LEAFNAME_PREFIX);
+    }
+}
+
+/** Prefixes of the terms add_file_metadata() builds itself.
+ *
+ *  The other terms it adds are passed in, as are those add_path_terms()
+ *  adds.
+ */
+static const char DATE_PREFIX = 'D';
+static const char MONTH_PREFIX = 'M';
+static const char YEAR_PREFIX = 'Y';
+static const char ACCESS_PREFIX = 'I';
+static const char OWNER_PREFIX = 'O';
+static const char EXTENSION_PREFIX = 'E';
+
+/** Add the terms and values which depend on the file's location and
+ *  filesystem metadata rather than on its contents.
+ */
+static void
+add_file_metadata(Xapian::Document& doc, DirectoryIterator& d,
+		  const string& urlterm, const string& ext)
+{
+    doc.add_boolean_term(site_term);
+
+    if (!host_term.empty())
+	doc.add_boolean_term(host_term);
+
+    time_t mtime = d.get_mtime();
+    if (date_terms) {
+	struct tm* tm = localtime(&mtime);
+	string date_term(1, DATE_PREFIX);
+	date_term += date_to_string(tm->tm_year + 1900,
+				    tm->tm_mon + 1,
+				    tm->tm_mday);
+	doc.add_boolean_term(date_term); // Date (YYYYMMDD)
+	date_term.resize(7);
+	date_term[0] = MONTH_PREFIX;
+	doc.add_boolean_term(date_term); // Month (YYYYMM)
+	date_term.resize(5);
+	date_term[0] = YEAR_PREFIX;
+	doc.add_boolean_term(date_term); // Year (YYYY)
+    }
+
+    doc.add_boolean_term(urlterm); // Url
+
+    // Add mtime as a value to allow "sort by date".
+    doc.add_value(VALUE_LASTMOD, int_to_binary_string(uint32_t(mtime)));
+    if (use_ctime) {
+	// Add ctime as a value to track modifications.
+	time_t ctime = d.get_ctime();
+	doc.add_value(VALUE_CTIME, int_to_binary_string(uint32_t(ctime)));
+    }
+
+    bool inc_tag_added = false;
+    string access_term(1, ACCESS_PREFIX);
+    if (d.is_other_readable()) {
+	inc_tag_added = true;
+	doc.add_boolean_term(access_term + '*');
+    } else if (d.is_group_readable()) {
+	const char* group = d.get_group();
+	if (group) {
+	    doc.add_boolean_term(access_term + '#' + group);
+	}
+    }
+    const char* owner = d.get_owner();
+    if (owner) {
+	doc.add_boolean_term(string(1, OWNER_PREFIX) + owner);
+	if (!inc_tag_added && d.is_owner_readable())
+	    doc.add_boolean_term(access_term + '@' + owner);
+    }
+
+    string ext_term(1, EXTENSION_PREFIX);
+    for (string::const_iterator i = ext.begin(); i != ext.end(); ++i) {
+	char ch = *i;
+	if (ch >= 'A' && ch <= 'Z')
+	    ch |= 32;
+	ext_term += ch;
+    }
+    doc.add_boolean_term(ext_term);
+}
+
+/** Add spelling data recorded by spelling_indexer.
+ *
+ *  @param spellings	spelling_doc serialised.
+ */
+static void
+add_spellings(const string& spellings)
+{
+    Xapian::Document doc = Xapian::Document::unserialise(spellings);
+    for (auto t = doc.termlist_begin(); t != doc.termlist_end(); ++t) {
+	db.add_spelling(*t, t.get_wdf());
+    }
+}
+
+/** Is @a did a document indexed from content with this MD5, size and type? */
+static bool
+content_matches(Xapian::docid did, const string& md5,
+		const string& size_value, const string& type_term,
+		Xapian::Document& doc)
+{
+    try {
+	doc = db.get_document(did);
+    } catch (const Xapian::DocNotFoundError&) {
+	return false;
+    }
+    if (doc.get_value(VALUE_MD5) != md5 ||
+	doc.get_value(VALUE_SIZE) != size_value) {
+	return false;
+    }
+    Xapian::TermIterator t = doc.termlist_begin();
+    t.skip_to(type_term);
+    return t != doc.termlist_end() && *t == type_term;
+}
+
+/** Does @a term depend on the file rather than on its contents?
+ *
+ *  These are the terms add_file_metadata(), add_path_terms() and
+ *  index_leafname() add, and the stemmed forms of the leafname.
+ */
+static bool
+is_file_term(const string& term, const string& urlterm,
+	     const string& pathterm)
+{
+    char prefix = term[0];
+    if (prefix == 'Z')
+	return term.size() > 1 && term[1] == LEAFNAME_PREFIX[0];
+    return prefix == LEAFNAME_PREFIX[0] ||
+	   prefix == DATE_PREFIX ||
+	   prefix == MONTH_PREFIX ||
+	   prefix == YEAR_PREFIX ||
+	   prefix == ACCESS_PREFIX ||
+	   prefix == OWNER_PREFIX ||
+	   prefix == EXTENSION_PREFIX ||
+	   prefix == urlterm[0] ||
+	   prefix == pathterm[0] ||
+	   prefix == site_term[0] ||
+	   (!host_term.empty() && prefix == host_term[0]);
+}
+
+#ifdef HAVE_FORK
+static void collect_all_extractions();
+#endif
+
+/** Try to build the document for a file by reusing one with the same content.
+ *
+ *  This avoids extracting the text again for a file which has been touched
+ *  but not changed, or which is a copy of another file we've indexed.  The
+ *  content-derived terms, values and sample are kept, and everything which
+ *  depends on the file's location or filesystem metadata is replaced.
+ *
+ *  @param[out] doc	The document for the file.
+ *  @param[out] spellings	The spelling data for the document, if recorded.
+ *
+ *  @return The docid of the document reused, or 0 if there isn't one.
+ */
+static Xapian::docid
+reuse_content(const string& urlterm, const string& url, const string& ext,
+	      const string& mimetype, DirectoryIterator& d,
+	      const string& pathterm, Xapian::docid did, const string& md5,
+	      Xapian::Document& doc, string& spellings)
+{
+    string size_value = Xapian::sortable_serialise(d.get_size());
+    string type_term = "T" + mimetype;
+
+    // Prefer the document we'd otherwise replace, falling back to the
+    // content cache for copies.
+    Xapian::docid old_did = did;
+    if (old_did == 0) {
+	Xapian::PostingIterator p = db.postlist_begin(urlterm);
+	if (p != db.postlist_end(urlterm)) old_did = *p;
+    }
+    Xapian::docid source_did = 0;
+    if (old_did && content_matches(old_did, md5, size_value, type_term, doc)) {
+	source_did = old_did;
+    } else {
+	string key = content_cache_key(md5, size_value);
+	string entry = db.get_metadata(key);
+#ifdef HAVE_FORK
+	if (!entry.empty() && !pending_extractions.empty()) {
+	    // Files found earlier but still being extracted could replace
+	    // documents with this content, so wait for them to be indexed to
+	    // get the same result as handling one file at a time.
+	    collect_all_extractions();
+	    entry = db.get_metadata(key);
+	}
+#endif
+	for (Xapian::docid cached_did : parse_content_cache_entry(entry)) {
+	    if (content_matches(cached_did, md5, size_value, type_term, doc)) {
+		source_did = cached_did;
+		break;
+	    }
+	}
+	if (!source_did) return 0;
+    }
+
+    spellings = db.get_metadata(content_cache_spellings_key(source_did));
+    // Without the spelling data the document added we'd have to guess, so
+    // extract the text again instead.
+    if (spelling && spellings.empty()) return 0;
+
+    // Find where the leafname was indexed so the new leafname can go in the
+    // same place, and remove the terms which depend on the file.
+    Xapian::termpos leaf_pos = 0, leaf_end = 0;
+    vector<string> old_terms;
+    for (auto t = doc.termlist_begin(); t != doc.termlist_end(); ++t) {
+	const string& term = *t;
+	if (!is_file_term(term, urlterm, pathterm)) continue;
+	if (term[0] == LEAFNAME_PREFIX[0]) {
+	    for (auto p = t.positionlist_begin();
+		 p != t.positionlist_end();
+		 ++p) {
+		if (leaf_pos == 0 || *p < leaf_pos) leaf_pos = *p;
+		leaf_end = max(leaf_end, *p);
+	    }
+	}
+	old_terms.push_back(term);
+    }
+    // The leafname always produces at least one term unless it has no
+    // word characters, in which case we just extract the file again.
+    if (leaf_pos <= 100) return 0;
+
+    // Update the url and modification time in the document data.
+    string record;
+    const string& old_record = doc.get_data();
+    time_t mtime = d.get_mtime();
+    bool have_modtime = false;
+    size_t start = 0;
+    while (start < old_record.size()) {
+	size_t end = old_record.find('\n', start);
+	if (end == string::npos) end = old_record.size();
+	if (!record.empty()) record += '\n';
+	if (old_record.compare(start, CONST_STRLEN("url="), "url=") == 0) {
+	    record += "url=";
+	    record += url;
+	} else if (old_record.compare(start, CONST_STRLEN("modtime="),
+				      "modtime=") == 0) {
+	    record += "modtime=";
+	    record += str(mtime);
+	    have_modtime = true;
+	} else {
+	    record.append(old_record, start, end - start);
+	}
+	start = end + 1;
+    }
+    if (!have_modtime) return 0;
+
+    for (auto&& term : old_terms) {
+	doc.remove_term(term);
+    }
+
+    // Note the positions of terms indexed after the leafname, since they
+    // need to move if the new leafname has a different number of words.
+    vector<pair<string, vector<Xapian::termpos>>> after_leaf;
+    for (auto t = doc.termlist_begin(); t != doc.termlist_end(); ++t) {
+	auto p = t.positionlist_begin();
+	if (p == t.positionlist_end()) continue;
+	p.skip_to(leaf_end + 1);
+	if (p == t.positionlist_end()) continue;
+	after_leaf.emplace_back(*t, vector<Xapian::termpos>(
+					t.positionlist_begin(),
+					t.positionlist_end()));
+    }
+
+    doc.remove_value(VALUE_CTIME);
+    doc.set_data(record);
+    add_path_terms(doc, pathterm);
+    indexer.set_document(doc);
+    indexer.set_termpos(leaf_pos - 101);
+    index_leafname(d);
+    Xapian::termpos new_leaf_end = indexer.get_termpos();
+    if (new_leaf_end != leaf_end) {
+	auto max_pos = numeric_limits<Xapian::termpos>::max();
+	for (auto&& i : after_leaf) {
+	    // Move the positions but leave the wdf alone.
+	    const string& term = i.first;
+	    doc.remove_postings(term, 1, max_pos, 0);
+	    for (Xapian::termpos pos : i.second) {
+		if (pos > leaf_end) pos = pos - leaf_end + new_leaf_end;
+		doc.add_posting(term, pos, 0);
+	    }
+	}
+    }
+    add_file_metadata(doc, d, urlterm, ext);
+
+    if (spelling) add_spellings(spellings);
+    return source_did;
+}
+
+/// Extract the text and metadata from a file and index it.
+static void
+extract_document(const string& file, const string& urlterm, const string& url,
+		 const string& ext,
+		 const string& mimetype,
+		 DirectoryIterator& d,
+		 string pathterm,
+		 string record,
+		 const string& context,
+		 time_t last_altered,
+		 Xapian::docid did,
+		 string md5);
+
+#ifdef HAVE_FORK
+/// Stop an extraction subprocess, killing it if @a kill_it is true.
+static void
+stop_extractor(Extractor& extractor, bool kill_it)
+{
+    if (kill_it) kill(extractor.pid, SIGKILL);
+    // Closing the stream of files tells the subprocess to exit.
+    fclose(extractor.out);
+    fclose(extractor.in);
+    while (waitpid(extractor.pid, NULL, 0) < 0 && errno == EINTR) { }
+    extractor.pid = 0;
+}
+
+/// Stop any extraction subprocesses and discard their results.
+static void
+abandon_extractions()
+{
+    for (auto&& extractor : extractors) {
+	if (extractor.pid) stop_extractor(extractor, true);
+    }
+    extractors.clear();
+    idle_extractors.clear();
+    pending_extractions.clear();
 }
 
+/** Wait for the oldest extraction to finish and index its results.
+ *
+ *  Or if the oldest entry is a reused document, just index it.
+ *
+ *  Results are handled in the order the files were found so the database
+ *  ends up the same as if the files had been extracted one at a time.
+ */
+static void
+collect_extraction()
+{
+    PendingExtraction job = std::move(pending_extractions.front());
+    pending_extractions.pop_front();
+    if (job.extractor == NO_EXTRACTOR) {
+	cout << job.output << flush;
+	index_add_document(job.urlterm, job.last_altered, job.did, job.doc,
+			   job.spellings);
+	return;
+    }
+
+    Extractor& extractor = extractors[job.extractor];
+    idle_extractors.push_back(job.extractor);
+
+    Xapian::Document doc;
+    bool have_doc = false;
+    bool finished = false;
+    string output, error, spellings, s;
+    bool ok = true;
+    while (ok && !finished) {
+	switch (getc(extractor.in)) {
+	    case 'S': {
+		unsigned long last_mod, size;
+		ok = read_string(extractor.in, s) &&
+		     read_unsigned(extractor.in, last_mod) &&
+		     read_unsigned(extractor.in, size);
+		if (ok) failed.add(s, time_t(last_mod), off_t(size));
+		break;
+	    }
+	    case 'F':
+		ok = read_string(extractor.in, s);
+		if (ok) commands[s] = Filter();
+		break;
+	    case 'W':
+		ok = read_string(extractor.in, spellings);
+		if (ok) add_spellings(spellings);
+		break;
+	    case 'D':
+		ok = read_string(extractor.in, s);
+		if (ok) {
+		    doc = Xapian::Document::unserialise(s);
+		    have_doc = true;
+		}
+		break;
+	    case 'O':
+		ok = read_string(extractor.in, output);
+		break;
+	    case 'X':
+		ok = read_string(extractor.in, error);
+		break;
+	    case 'E':
+		finished = true;
+		break;
+	    default:
+		// EOF or garbage.
+		ok = false;
+		break;
+	}
+    }
+
+    cout << output;
+    if (!finished) {
+	// The subprocess died without reporting back - probably a parser bug,
+	// but at least it only took this file down with it.  A new subprocess
+	// gets started when one is next needed.
+	stop_extractor(extractor, true);
+	skip(job.urlterm, job.context, "extraction subprocess failed",
+	     job.size, job.mtime, SKIP_SHOW_FILENAME);
+	return;
+    }
+
+    if (!error.empty()) {
+	abandon_extractions();
+	throw CommitAndExit("Extraction subprocess failed", error.c_str());
+    }
+
+    if (!have_doc) return;
+
+    // Only keep the spelling data if it's wanted for the content cache.
+    if (!record_spellings) spellings.clear();
+    index_add_document(job.urlterm, job.last_altered, job.did, doc,
+		       spellings);
+}
+
+/// Wait for all extractions to finish and index their results.
+static void
+collect_all_extractions()
+{
+    while (!pending_extractions.empty())
+	collect_extraction();
+}
+
+/// Stop the extraction subprocesses.
+static void
+stop_extractors()
+{
+    for (auto&& extractor : extractors) {
+	if (extractor.pid) stop_extractor(extractor, false);
+    }
+}
+
+/** Extract files sent by the parent process until it closes @a in.
+ *
+ *  For each file we send back the document, along with any failures to
+ *  record, spelling data and output.
+ */
+[[noreturn]]
+static void
+run_extractor(FILE* in, FILE* out)
+{
+    extractor_out = out;
+
+    // Capture our output so it can be shown in the right order.
+    ostringstream output;
+    cout.rdbuf(output.rdbuf());
+
+    // The parent process adds the spelling data.
+    indexer.set_flags(Xapian::TermGenerator::flags(0),
+		      ~Xapian::TermGenerator::FLAG_SPELLING);
+    record_spellings = spelling;
+
+    // Only regular files get this far, so it doesn't matter whether we
+    // follow symlinks.
+    DirectoryIterator d(true);
+    string file, leaf, urlterm, url, ext, mimetype, pathterm, record;
+    string context, md5;
+    unsigned long last_altered, did;
+    while (read_string(in, file) &&
+	   read_string(in, leaf) &&
+	   read_string(in, urlterm) &&
+	   read_string(in, url) &&
+	   read_string(in, ext) &&
+	   read_string(in, mimetype) &&
+	   read_string(in, pathterm) &&
+	   read_string(in, record) &&
+	   read_string(in, context) &&
+	   read_string(in, md5) &&
+	   read_unsigned(in, last_altered) &&
+	   read_unsigned(in, did)) {
+	output.str(string());
+	d.start_entry(file.substr(0, file.size() - leaf.size()), leaf);
+
+	string error;
+	try {
+	    extract_document(file, urlterm, url, ext, mimetype, d,
+			     std::move(pathterm), std::move(record), context,
+			     time_t(last_altered), Xapian::docid(did),
+			     std::move(md5));
+	} catch (const CommitAndExit& e) {
+	    error = e.what();
+	} catch (const Xapian::Error& e) {
+	    error = e.get_description();
+	} catch (const exception& e) {
+	    error = e.what();
+	} catch (const string& e) {
+	    error = e;
+	} catch (const char* e) {
+	    error = e;
+	} catch (...) {
+	    error = "Caught unknown exception";
+	}
+
+	if (!error.empty()) {
+	    putc('X', out);
+	    write_string(out, error);
+	}
+	if (record_spellings) {
+	    putc('W', out);
+	    write_string(out, spelling_doc.serialise());
+	}
+	putc('O', out);
+	write_string(out, output.str());
+	putc('E', out);
+	if (fflush(out) != 0) {
+	    // The parent process has gone away.
+	    break;
+	}
+    }
+
+    remove_tmpdir();
+    // Don't run any destructors - in particular the database must only be
+    // touched by the parent process.
+    _exit(0);
+}
+
+/// Start an extraction subprocess.
+static void
+start_extractor(Extractor& extractor)
+{
+    // Ensure the subprocess doesn't start with anything left in our buffer.
+    cout.flush();
+
+    int to_child[2], from_child[2];
+    if (pipe(to_child) < 0)
+	throw CommitAndExit("Couldn't create pipe", errno);
+    if (pipe(from_child) < 0) {
+	int pipe_errno = errno;
+	close(to_child[0]);
+	close(to_child[1]);
+	throw CommitAndExit("Couldn't create pipe", pipe_errno);
+    }
+
+    pid_t child;
+    while ((child = fork()) < 0 && !pending_extractions.empty()) {
+	// Wait for an extraction to finish and retry.
+	collect_extraction();
+    }
+
+    if (child == 0) {
+	// We're the child process.
+	close(to_child[1]);
+	close(from_child[0]);
+	for (auto&& other : extractors) {
+	    if (other.pid) {
+		close(fileno(other.out));
+		close(fileno(other.in));
+	    }
+	}
+	run_extractor(fdopen(to_child[0], "r"), fdopen(from_child[1], "w"));
+    }
+
+    int fork_errno = errno;
+    close(to_child[0]);
+    close(from_child[1]);
+    if (child < 0) {
+	close(to_child[1]);
+	close(from_child[0]);
+	throw CommitAndExit("Couldn't fork extraction subprocess", fork_errno);
+    }
+
+    // Don't get killed if a subprocess exits while we're sending it a file.
+    signal(SIGPIPE, SIG_IGN);
+
+    extractor.pid = child;
+    extractor.out = fdopen(to_child[1], "w");
+    extractor.in = fdopen(from_child[0], "r");
+}
+
+/** Call extract_document() in an extraction subprocess.
+ *
+ *  The parent process remains the only writer to the database - the
+ *  subprocess sends back the document, and we add it once the files found
+ *  before it are done.
+ */
+static void
+extract_in_subprocess(const string& file, const string& urlterm,
+		      const string& url,
+		      const string& ext,
+		      const string& mimetype,
+		      DirectoryIterator& d,
+		      const string& pathterm,
+		      const string& record,
+		      const string& context,
+		      time_t last_altered,
+		      Xapian::docid did,
+		      const string& md5)
+{
+    if (extractors.empty()) {
+	extractors.resize(extract_jobs);
+	for (size_t i = extract_jobs; i != 0; --i) {
+	    idle_extractors.push_back(i - 1);
+	}
+    }
+    while (idle_extractors.empty())
+	collect_extraction();
+
+    size_t i = idle_extractors.back();
+    idle_extractors.pop_back();
+    Extractor& extractor = extractors[i];
+    if (!extractor.pid) start_extractor(extractor);
+
+    FILE* out = extractor.out;
+    if (!write_string(out, file) ||
+	!write_string(out, d.leafname()) ||
+	!write_string(out, urlterm) ||
+	!write_string(out, url) ||
+	!write_string(out, ext) ||
+	!write_string(out, mimetype) ||
+	!write_string(out, pathterm) ||
+	!write_string(out, record) ||
+	!write_string(out, context) ||
+	!write_string(out, md5) ||
+	!write_unsigned(out, static_cast<unsigned long>(last_altered)) ||
+	!write_unsigned(out, static_cast<unsigned long>(did)) ||
+	fflush(out) != 0) {
+	throw CommitAndExit("Couldn't send file to extraction subprocess",
+			    errno);
+    }
+
+    pending_extractions.push_back({i, urlterm, context, last_altered, did,
+				   d.get_size(), d.get_mtime(), string(),
+				   Xapian::Document(), string()});
+}
+#endif
+
 void
 index_mimetype(const string& file, const string& urlterm, const string& url,
 	       const string& ext,
@@ -746,28 +1677,75 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 	}
     }
 
+    string md5;
+    if (content_cache && d.md5(md5)) {
+	Xapian::Document doc;
+	string spellings;
+	Xapian::docid source_did = reuse_content(urlterm, url, ext, mimetype,
+						 d, pathterm, did, md5, doc,
+						 spellings);
+	if (source_did) {
+	    string output;
+	    if (verbose) {
+		output = "Indexing \"" + context + "\" as " + mimetype +
+			 " ... reusing document #" + str(source_did) +
+			 " ... ";
+	    }
+#ifdef HAVE_FORK
+	    if (!pending_extractions.empty()) {
+		// Index it once the files found before it have been.
+		pending_extractions.push_back({NO_EXTRACTOR, urlterm, context,
+					       last_altered, did,
+					       d.get_size(), d.get_mtime(),
+					       output, doc, spellings});
+		return;
+	    }
+#endif
+	    cout << output << flush;
+	    index_add_document(urlterm, last_altered, did, doc, spellings);
+	    return;
+	}
+    }
+
+#ifdef HAVE_FORK
+    if (extract_jobs > 1) {
+	extract_in_subprocess(file, urlterm, url, ext, mimetype, d,
+			      pathterm, record, context, last_altered, did,
+			      md5);
+	return;
+    }
+#endif
+
+    extract_document(file, urlterm, url, ext, mimetype, d,
+		     std::move(pathterm), std::move(record), context,
+		     last_altered, did, std::move(md5));
+}
+
+static void
+extract_document(const string& file, const string& urlterm, const string& url,
+		 const string& ext,
+		 const string& mimetype,
+		 DirectoryIterator& d,
+		 string pathterm,
+		 string record,
+		 const string& context,
+		 time_t last_altered,
+		 Xapian::docid did,
+		 string md5)
+{
     if (verbose)
 	cout << "Indexing \"" << file.substr(root.size()) << "\" as "
 	     << mimetype << " ... " << flush;
 
-    // Use `file` as the basis, as we don't want URL encoding in these terms,
-    // but need to switch over the initial part so we get `/~olly/foo/bar` not
-    // `/home/olly/public_html/foo/bar`.
     Xapian::Document newdocument;
-    size_t j;
-    while ((j = pathterm.rfind('/')) > 1 && j != string::npos) {
-	pathterm.resize(j);
-	if (pathterm.length() > MAX_SAFE_TERM_LENGTH) {
-	    string term_hash = hash_long_term(pathterm, MAX_SAFE_TERM_LENGTH);
-	    newdocument.add_boolean_term(term_hash);
-	} else {
-	    newdocument.add_boolean_term(pathterm);
-	}
+    add_path_terms(newdocument, std::move(pathterm));
+    if (record_spellings) {
+	spelling_doc = Xapian::Document();
+	spelling_indexer.set_document(spelling_doc);
     }
 
     string author, title, sample, keywords, topic, dump;
     string to, cc, bcc, message_id;
-    string md5;
     time_t created = time_t(-1);
     int pages = -1;
 
@@ -804,7 +1782,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 		    } else {
 			filter_entry = mimetype;
 		    }
-		    commands[filter_entry] = Filter();
+		    disable_filter(filter_entry);
 		}
 		return;
 	    }
@@ -1403,37 +2381,17 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 	    indexer.increase_termpos(100);
 	}
 	if (!dump.empty()) {
-	    indexer.index_text(dump);
+	    index_unprefixed_text(dump);
 	}
 	if (!keywords.empty()) {
 	    indexer.increase_termpos(100);
-	    indexer.index_text(keywords);
+	    index_unprefixed_text(keywords);
 	}
 	if (!topic.empty()) {
 	    indexer.increase_termpos(100);
 	    indexer.index_text(topic, 1, "B");
 	}
-	// Index the leafname of the file.
-	{
-	    indexer.increase_termpos(100);
-	    string leaf = d.leafname();
-	    string::size_type dot = leaf.find_last_of('.');
-	    if (dot != string::npos && leaf.size() - dot - 1 <= max_ext_len)
-		leaf.resize(dot);
-	    indexer.index_text(leaf, 1, "F");
-
-	    // Also index with underscores and ampersands replaced by spaces.
-	    bool modified = false;
-	    string::size_type rep = 0;
-	    while ((rep = leaf.find_first_of("_&", rep)) != string::npos) {
-		leaf[rep++] = ' ';
-		modified = true;
-	    }
-	    if (modified) {
-		indexer.increase_termpos(100);
-		indexer.index_text(leaf, 1, "F");
-	    }
-	}
+	index_leafname(d);
 
 	if (!author.empty()) {
 	    indexer.increase_termpos(100);
@@ -1462,37 +2420,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 	// mimeType:
 	newdocument.add_boolean_term("T" + mimetype);
 
-	newdocument.add_boolean_term(site_term);
-
-	if (!host_term.empty())
-	    newdocument.add_boolean_term(host_term);
-
-	if (date_terms) {
-	    struct tm* tm = localtime(&mtime);
-	    string date_term = "D";
-	    date_term += date_to_string(tm->tm_year + 1900,
-					tm->tm_mon + 1,
-					tm->tm_mday);
-	    newdocument.add_boolean_term(date_term); // Date (YYYYMMDD)
-	    date_term.resize(7);
-	    date_term[0] = 'M';
-	    newdocument.add_boolean_term(date_term); // Month (YYYYMM)
-	    date_term.resize(5);
-	    date_term[0] = 'Y';
-	    newdocument.add_boolean_term(date_term); // Year (YYYY)
-	}
-
-	newdocument.add_boolean_term(urlterm); // Url
-
-	// Add mtime as a value to allow "sort by date".
-	newdocument.add_value(VALUE_LASTMOD,
-			      int_to_binary_string(uint32_t(mtime)));
-	if (use_ctime) {
-	    // Add ctime as a value to track modifications.
-	    time_t ctime = d.get_ctime();
-	    newdocument.add_value(VALUE_CTIME,
-				  int_to_binary_string(uint32_t(ctime)));
-	}
+	add_file_metadata(newdocument, d, urlterm, ext);
 
 	// Add MD5 as a value to allow duplicate documents to be collapsed
 	// together.
@@ -1508,33 +2436,17 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 				  int_to_binary_string(uint32_t(created)));
 	}
 
-	bool inc_tag_added = false;
-	if (d.is_other_readable()) {
-	    inc_tag_added = true;
-	    newdocument.add_boolean_term("I*");
-	} else if (d.is_group_readable()) {
-	    const char* group = d.get_group();
-	    if (group) {
-		newdocument.add_boolean_term(string("I#") + group);
-	    }
-	}
-	const char* owner = d.get_owner();
-	if (owner) {
-	    newdocument.add_boolean_term(string("O") + owner);
-	    if (!inc_tag_added && d.is_owner_readable())
-		newdocument.add_boolean_term(string("I@") + owner);
-	}
-
-	string ext_term("E");
-	for (string::const_iterator i = ext.begin(); i != ext.end(); ++i) {
-	    char ch = *i;
-	    if (ch >= 'A' && ch <= 'Z')
-		ch |= 32;
-	    ext_term += ch;
+#ifdef HAVE_FORK
+	if (extractor_out) {
+	    // The parent process adds the document to the database.
+	    putc('D', extractor_out);
+	    write_string(extractor_out, newdocument.serialise());
+	    return;
 	}
-	newdocument.add_boolean_term(ext_term);
-
-	index_add_document(urlterm, last_altered, did, newdocument);
+#endif
+	string spellings;
+	if (record_spellings) spellings = spelling_doc.serialise();
+	index_add_document(urlterm, last_altered, did, newdocument, spellings);
     } catch (const ReadError&) {
 	skip(urlterm, context, string("can't read file: ") + strerror(errno),
 	     d.get_size(), d.get_mtime());
@@ -1549,7 +2461,7 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 	m += filter_entry;
 	m += "\" not installed";
 	skip(urlterm, context, m, d.get_size(), d.get_mtime());
-	commands[filter_entry] = Filter();
+	disable_filter(filter_entry);
     } catch (const FileNotFound&) {
 	skip(urlterm, context, "File removed during indexing",
 	     d.get_size(), d.get_mtime(),
@@ -1570,6 +2482,10 @@ index_mimetype(const string& file, const string& urlterm, const string& url,
 void
 index_handle_deletion()
 {
+#ifdef HAVE_FORK
+    collect_all_extractions();
+#endif
+
     if (updated.empty() || old_docs_not_seen == 0) return;
 
     if (verbose) {
@@ -1588,6 +2504,7 @@ index_handle_deletion()
 		did = *alldocs;
 		continue;
 	    }
+	    if (have_content_cache) content_cache_remove(did);
 	    db.delete_document(did);
 	    if (--old_docs_not_seen == 0)
 		break;
@@ -1599,12 +2516,24 @@ index_handle_deletion()
 void
 index_commit()
 {
+#ifdef HAVE_FORK
+    try {
+	collect_all_extractions();
+    } catch (const CommitAndExit& e) {
+	// We're probably already committing due to an earlier CommitAndExit.
+	cout << "Exception: " << e.what() << endl;
+    }
+#endif
     db.commit();
 }
 
 void
 index_done()
 {
+#ifdef HAVE_FORK
+    stop_extractors();
+#endif
+
     // If we created a temporary directory then delete it.
     remove_tmpdir();
 }
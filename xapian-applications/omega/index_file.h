@@ -133,14 +133,21 @@ index_init(const std::string& dbpath, const Xapian::Stem& stemmer,
 	   bool overwrite, bool retry_failed_,
 	   bool delete_removed_documents, bool verbose_, bool use_ctime_,
 	   bool spelling, bool ignore_exclusions_, bool description_as_sample,
-	   bool date_terms);
+	   bool date_terms, unsigned extract_jobs, bool content_cache);
 
 void
 index_remove_failed_entry(const std::string& urlterm);
 
+/** Add or replace the document for a file.
+ *
+ *  @param spellings	The spelling data indexing @a doc added, serialised as
+ *			a Document with the frequency of each word as its
+ *			wdf, or an empty string if it wasn't recorded.
+ */
 void
 index_add_document(const std::string& urlterm, time_t last_altered,
-		   Xapian::docid did, const Xapian::Document& doc);
+		   Xapian::docid did, const Xapian::Document& doc,
+		   const std::string& spellings);
 
 /// Index a file into the database.
 void
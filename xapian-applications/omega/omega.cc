@@ -44,6 +44,8 @@
 #include "stringutils.h"
 #include "expand.h"
 #include "parseint.h"
+#include "realtime.h"
+#include "scgi.h"
 
 using namespace std;
 
@@ -81,19 +83,47 @@ Xapian::Enquire::docid_order docid_order = Xapian::Enquire::ASCENDING;
 Xapian::valueno collapse_key = 0;
 bool collapse = false;
 
+/// How often (in seconds) to check if an open database has been updated.
+static const double DB_REOPEN_INTERVAL = 1.0;
+
+/// A database opened by an earlier request.
+struct OpenDatabase {
+    Xapian::Database db;
+    double last_reopen;
+};
+
+// Databases are kept open so that a process handling several requests only
+// opens each once.
+static map<string, OpenDatabase> open_databases;
+
 static string
 map_dbname_to_dir(const string &database_name)
 {
     return database_dir + database_name;
 }
 
+static Xapian::Database
+open_database(const string& path)
+{
+    double now = RealTime::now();
+    auto it = open_databases.find(path);
+    if (it == open_databases.end()) {
+	OpenDatabase entry{Xapian::Database(path), now};
+	it = open_databases.emplace(path, entry).first;
+    } else if (now - it->second.last_reopen >= DB_REOPEN_INTERVAL) {
+	it->second.db.reopen();
+	it->second.last_reopen = now;
+    }
+    return it->second.db;
+}
+
 static void
 add_database(const string& this_dbname)
 {
     if (!dbname.empty()) dbname += '/';
     dbname += this_dbname;
 
-    Xapian::Database this_db(map_dbname_to_dir(this_dbname));
+    Xapian::Database this_db = open_database(map_dbname_to_dir(this_dbname));
     db.add_database(this_db);
 
     size_t this_db_size = this_db.size();
@@ -174,8 +204,44 @@ filters_append(const string& bterm, const string* prev)
     old_filters += filter_sep;
 }
 
-int main(int argc, char *argv[])
-try {
+// Reset the state left by any previous request.
+static void
+reset_state()
+{
+    reset_query_state();
+
+    delete enquire;
+    enquire = NULL;
+    db = Xapian::Database();
+
+    option.clear();
+    set_content_type = false;
+    suppress_http_headers = false;
+
+    dbname.resize(0);
+    fmtname.resize(0);
+    filters.resize(0);
+    old_filters.resize(0);
+
+    hits_per_page = 0;
+    min_hits = 0;
+    threshold = 0;
+
+    delete sort_keymaker;
+    sort_keymaker = NULL;
+    sort_key = Xapian::BAD_VALUENO;
+    reverse_sort = true;
+    sort_after = false;
+    docid_order = Xapian::Enquire::ASCENDING;
+
+    collapse_key = 0;
+    collapse = false;
+}
+
+// Process the request whose parameters are in cgi_params.
+static void
+process_request()
+{
     {
 	// Check for SERVER_PROTOCOL=INCLUDED, which is set when we're being
 	// included in a page via a server-side include directive.  In this
@@ -186,8 +252,6 @@ try {
 	}
     }
 
-    read_config_file();
-
     option["flag_default"] = "true";
 
     // set default thousands and decimal separators: e.g. "16,729 hits" "1.4K"
@@ -197,31 +261,6 @@ try {
     // set the default stemming language
     option["stemmer"] = DEFAULT_STEM_LANGUAGE;
 
-    // FIXME: set cout to linebuffered not stdout.  Or just flush regularly...
-    // setvbuf(stdout, NULL, _IOLBF, 0);
-
-    const char * method = getenv("REQUEST_METHOD");
-    if (method == NULL) {
-	if (argc > 1 && (argv[1][0] != '-' || strchr(argv[1], '='))) {
-	    // omega 'P=information retrieval' DB=papers
-	    // check for a leading '-' on the first arg so "omega --version",
-	    // "omega --help", and similar take the next branch
-	    decode_argv(argv + 1);
-	} else {
-	    // Seems we're running from the command line so give version
-	    // and allow a query to be entered for testing
-	    cout << PROGRAM_NAME " - " PACKAGE " " VERSION "\n";
-	    if (argc > 1) exit(0);
-	    cout << "Enter NAME=VALUE lines, end with blank line\n";
-	    decode_test();
-	}
-    } else {
-	if (*method == 'P')
-	    decode_post();
-	else
-	    decode_get();
-    }
-
     try {
 	parse_db_params(cgi_params.equal_range("DB"));
 	if (dbname.empty()) {
@@ -726,6 +765,13 @@ try {
     }
 
     parse_omegascript();
+}
+
+// Report the exception currently being handled.
+static void
+report_exception()
+try {
+    throw;
 } catch (const Xapian::Error &e) {
     if (!set_content_type && !suppress_http_headers)
 	cout << "Content-Type: text/html\n\n";
@@ -747,3 +793,58 @@ try {
 	cout << "Content-Type: text/html\n\n";
     cout << "Caught unknown exception" << endl;
 }
+
+// Handle one request in a persistent server process.
+static void
+handle_request()
+{
+    try {
+	reset_state();
+	process_request();
+    } catch (...) {
+	report_exception();
+    }
+}
+
+int main(int argc, char *argv[])
+try {
+    read_config_file();
+
+#ifndef __WIN32__
+    if (argc == 2 && startswith(argv[1], "--scgi=")) {
+	// Serve requests over SCGI, keeping databases, templates and cdb
+	// files open between requests.
+	scgi_serve(argv[1] + CONST_STRLEN("--scgi="), handle_request);
+	exit(1);
+    }
+#endif
+
+    // FIXME: set cout to linebuffered not stdout.  Or just flush regularly...
+    // setvbuf(stdout, NULL, _IOLBF, 0);
+
+    const char * method = getenv("REQUEST_METHOD");
+    if (method == NULL) {
+	if (argc > 1 && (argv[1][0] != '-' || strchr(argv[1], '='))) {
+	    // omega 'P=information retrieval' DB=papers
+	    // check for a leading '-' on the first arg so "omega --version",
+	    // "omega --help", and similar take the next branch
+	    decode_argv(argv + 1);
+	} else {
+	    // Seems we're running from the command line so give version
+	    // and allow a query to be entered for testing
+	    cout << PROGRAM_NAME " - " PACKAGE " " VERSION "\n";
+	    if (argc > 1) exit(0);
+	    cout << "Enter NAME=VALUE lines, end with blank line\n";
+	    decode_test();
+	}
+    } else {
+	if (*method == 'P')
+	    decode_post();
+	else
+	    decode_get();
+    }
+
+    process_request();
+} catch (...) {
+    report_exception();
+}
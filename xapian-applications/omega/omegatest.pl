@@ -1452,6 +1452,78 @@ test_scriptindex_error 'missing unique field',
   "<stdin>:4: error: UNIQUE action unused in this record",
   "id=1\nf=wan\n\nf=";
 
+# Run scriptindex on $input with the extra options in @args, indexing into
+# $db.  Returns the exit code and the combined stdout+stderr output.
+sub scriptindex_output {
+  my ($db, $input, @args) = @_;
+  remove_tree($db);
+  my $opts = join(' ', map { "'$_'" } @args);
+  my $out = `$scriptindex $opts '$db' '$test_indexscript' <<'__END__' 2>&1
+$input
+__END__`;
+  my $rc = $? >> 8;
+  $out =~ s/\r\n/\n/g;
+  return ($rc, $out);
+}
+
+# Test that indexing with worker processes (`--jobs`) gives the same output
+# and database as indexing serially.  Records reuse `unique` identifiers
+# while earlier records with them are still being indexed by other workers.
+my $jobs_db = 'test-db-jobs';
+print_to_file $test_indexscript, <<'END';
+id : boolean=Q unique=Q,missing=warn+new
+s : spell index field
+t : index=XT field
+d : field parsedate=%Y%m%d valuepacked=0
+END
+my $jobs_input = '';
+for my $i (1 .. 12) {
+  my $id = $i % 5;
+  $jobs_input .= "id=$id\n" if $i % 4;
+  $jobs_input .= "s=spelling words record$i\n" if $i % 3;
+  $jobs_input .= "t=text for record $i\n" if $i % 7;
+  $jobs_input .= "d=2023010" . ($i % 9) . "\n" if $i % 2;
+  $jobs_input .= "\n";
+}
+# Delete a document.
+$jobs_input .= "id=2\n";
+my ($serial_rc, $serial_out) = scriptindex_output($test_db, $jobs_input);
+if ($serial_rc != 0 || $serial_out !~ $summary_re) {
+  print "scriptindex gave unexpected output for serial `--jobs` reference\n";
+  print "Output: $serial_out\n";
+  ++$failed;
+}
+my ($jobs_rc, $jobs_out) = scriptindex_output($jobs_db, $jobs_input, '--jobs=3');
+if ($jobs_rc != $serial_rc || $jobs_out ne $serial_out) {
+  print "scriptindex --jobs=3 output differed from serial output\n";
+  print "Expect: $serial_out\n";
+  print "Output: $jobs_out\n";
+  ++$failed;
+}
+my $check_out = `./omindexcheck '$jobs_db' '$test_db' 2>&1`;
+if ($? != 0) {
+  print "scriptindex --jobs=3 database differed from serial database\n";
+  print "Output: $check_out\n";
+  ++$failed;
+}
+remove_tree($jobs_db);
+
+# Test diagnostics for earlier fields of a record come before an error for a
+# line without `=`, with and without worker processes.
+print_to_file $test_indexscript, "id : boolean=Q unique=Q\nDATE : parsedate=%Y%m%d field\n";
+for my $args ([], ['--jobs=2']) {
+  my ($rc, $out) = scriptindex_output($test_db, "id=1\n\nid=2\nDATE=20161202x\nbad", @$args);
+  chomp($out);
+  my $expect = '<stdin>:5: warning: "20161202x" not fully matched by format "%Y%m%d" ("x" left over) but indexing anyway
+<stdin>:5: error: Expected = somewhere in this line';
+  if ($rc == 0 || $out ne $expect) {
+    print "scriptindex @$args gave unexpected diagnostics for line without =\n";
+    print "Expect: $expect\n";
+    print "Output: $out\n";
+    ++$failed;
+  }
+}
+
 # Test $subdb and $subid.
 remove_tree($test_db);
 print_to_file $test_db, 'inmemory';
@@ -1729,6 +1801,69 @@ print_to_file $test_template, '$hitlist{$list{$terms{T},|}/$field{tag1}|$field{t
 testcase('Tone/one|two|three', 'B=Tone');
 testcase('Tthree|Ttwo/one|two|three', 'B=Ttwo', 'B=Tthree');
 
+# Test SCGI server mode, which handles several requests in one process, so
+# check the state from one request doesn't leak into the next.
+if ($^O ne 'MSWin32') {
+  require IO::Socket::UNIX;
+
+  my $socket_path = 'test-scgi-socket';
+  unlink $socket_path;
+  my $pid = fork // die $!;
+  if ($pid == 0) {
+    exec ref $omega ? @$omega : $omega, "--scgi=$socket_path" or die $!;
+  }
+  # Wait for the server to start listening.
+  for (1 .. 100) {
+    last if -S $socket_path;
+    select(undef, undef, undef, 0.1);
+  }
+
+  # Send a request with the headers given as a list of names and values and
+  # return the response.
+  my $scgi_request = sub {
+    my $data = join('', map { "$_\0" } @_);
+    my $sock = IO::Socket::UNIX->new(Peer => $socket_path)
+      or die "Couldn't connect to $socket_path: $!";
+    print $sock length($data), ':', $data, ',';
+    local $/ = undef;
+    my $response = <$sock>;
+    close $sock;
+    $response =~ s/\r\n/\n/g;
+    chomp($response);
+    return $response;
+  };
+
+  my $scgi_testcase = sub {
+    my ($expected, $query_string) = @_;
+    my $output = $scgi_request->('CONTENT_LENGTH', '0', 'SCGI', '1',
+				 'REQUEST_METHOD', 'GET',
+				 'QUERY_STRING', $query_string);
+    if ($output ne $expected) {
+      print "SCGI request $query_string:\n";
+      print "  expected: «${expected}»\n";
+      print "  received: «${output}»\n";
+      ++$failed;
+    }
+  };
+
+  print_to_file $test_template, '[$opt{x}]$set{x,$cgi{X}}[$opt{x}]$querydescription';
+  $scgi_testcase->('[][1]Query((Zfoo@1 FILTER Tone))', 'P=foo&B=Tone&X=1');
+  $scgi_testcase->('[][]Query(Zbar@1)', 'P=bar');
+
+  # An oversized request body should be rejected without being read.
+  my $output = $scgi_request->('CONTENT_LENGTH', '1000000000', 'SCGI', '1',
+			       'REQUEST_METHOD', 'POST');
+  if ($output !~ /^Status: 413 /) {
+    print "Oversized SCGI request not rejected: «${output}»\n";
+    ++$failed;
+  }
+  $scgi_testcase->('[][]Query(Zbaz@1)', 'P=baz');
+
+  kill 'TERM', $pid;
+  waitpid($pid, 0);
+  unlink $socket_path;
+}
+
 unlink $OMEGA_CONFIG_FILE, $test_indexscript, $test_template;
 remove_tree($test_db);
 if ($failed == 0) {
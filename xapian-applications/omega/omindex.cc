@@ -362,6 +362,8 @@ main(int argc, char **argv)
     bool description_as_sample = false;
     string baseurl;
     size_t depth_limit = 0;
+    unsigned extract_jobs = 1;
+    bool content_cache = false;
     size_t title_size = TITLE_SIZE;
     size_t sample_size = SAMPLE_SIZE;
     empty_body_type empty_body = EMPTY_BODY_WARN;
@@ -374,7 +376,8 @@ main(int argc, char **argv)
 	OPT_DATE_TERMS,
 	OPT_NO_DATE_TERMS,
 	OPT_READ_FILTERS,
-	OPT_READ_WORKERS
+	OPT_READ_WORKERS,
+	OPT_CONTENT_CACHE
     };
     constexpr auto NO_ARG = no_argument;
     constexpr auto REQ_ARG = required_argument;
@@ -406,6 +409,8 @@ main(int argc, char **argv)
 	{ "retry-failed",	NO_ARG,		NULL, 'R' },
 	{ "opendir-sleep",	REQ_ARG,	NULL, OPT_OPENDIR_SLEEP },
 	{ "track-ctime",	NO_ARG,		NULL, 'C' },
+	{ "jobs",		REQ_ARG,	NULL, 'j' },
+	{ "content-cache",	NO_ARG,		NULL, OPT_CONTENT_CACHE },
 	{ "date-terms",		NO_ARG,		NULL, OPT_DATE_TERMS },
 	{ "no-date-terms",	NO_ARG,		NULL, OPT_NO_DATE_TERMS },
 	{ 0, 0, NULL, 0 }
@@ -427,7 +432,7 @@ main(int argc, char **argv)
     string dbpath;
     int getopt_ret;
     while ((getopt_ret = gnu_getopt_long(argc, argv,
-					 "hvd:D:U:M:G:F:W:l:s:pfRSVe:im:E:T:C",
+					 "hvd:D:U:M:G:F:W:l:s:pfRSVe:im:E:T:Cj:",
 					 longopts, NULL)) != -1) {
 	switch (getopt_ret) {
 	case 'h': {
@@ -503,6 +508,12 @@ main(int argc, char **argv)
 "                            on Microsoft DFS shares.\n"
 "  -C, --track-ctime         track each file's ctime so we can detect changes\n"
 "                            to ownership or permissions.\n"
+"  -j, --jobs=N              extract text from up to N files at once, using N\n"
+"                            subprocesses (default: 1)\n"
+"      --content-cache       reuse the document indexed from a file with the\n"
+"                            same contents (such as an unchanged file with a\n"
+"                            new timestamp, or a copy) instead of extracting\n"
+"                            the text again\n"
 "      --date-terms          index D, M and Y prefixed terms to support date\n"
 "                            range filtering using terms (we now recommend\n"
 "                            using a value slot for this instead).\n"
@@ -716,6 +727,16 @@ main(int argc, char **argv)
 	case 'C':
 	    use_ctime = true;
 	    break;
+	case 'j':
+	    if (!parse_unsigned(optarg, extract_jobs) || extract_jobs == 0) {
+		cerr << PROG_NAME": bad --jobs argument: "
+		     "'" << optarg << "'" << endl;
+		return 1;
+	    }
+	    break;
+	case OPT_CONTENT_CACHE:
+	    content_cache = true;
+	    break;
 	case OPT_DATE_TERMS:
 	    date_terms = true;
 	    break;
@@ -845,7 +866,8 @@ main(int argc, char **argv)
 		   sample_size, title_size, max_ext_len,
 		   overwrite, retry_failed, delete_removed_documents, verbose,
 		   use_ctime, spelling, ignore_exclusions,
-		   description_as_sample, date_terms);
+		   description_as_sample, date_terms, extract_jobs,
+		   content_cache);
 	index_directory(root, baseurl, depth_limit, mime_map);
 	index_handle_deletion();
 	index_commit();
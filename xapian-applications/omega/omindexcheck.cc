@@ -28,10 +28,14 @@
 #include <algorithm>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "parseint.h"
 #include "values.h"
 
 using namespace std;
@@ -378,6 +382,226 @@ compare_test(testcase& test, const Xapian::Document& doc, const string& file)
     return FAIL;
 }
 
+/// Report a difference between documents in compare_databases().
+static void
+report_difference(Xapian::docid did, const string& what)
+{
+    cerr << "Document #" << did << ": error: " << what << '\n';
+}
+
+/** Check that @a db contains exactly the same as @a ref.
+ *
+ *  Used to check that extracting several files at once gives the same
+ *  database as extracting them one at a time.
+ */
+static test_result
+compare_databases(const Xapian::Database& db, const Xapian::Database& ref)
+{
+    if (db.get_doccount() != ref.get_doccount() ||
+	db.get_lastdocid() != ref.get_lastdocid()) {
+	cerr << "error: Database has " << db.get_doccount()
+	     << " documents with highest docid " << db.get_lastdocid()
+	     << ", expected " << ref.get_doccount() << " and "
+	     << ref.get_lastdocid() << '\n';
+	return FAIL;
+    }
+
+    test_result result = PASS;
+    for (auto p = ref.postlist_begin(string());
+	 p != ref.postlist_end(string());
+	 ++p) {
+	Xapian::docid did = *p;
+	Xapian::Document ref_doc = ref.get_document(did);
+	Xapian::Document doc;
+	try {
+	    doc = db.get_document(did);
+	} catch (const Xapian::DocNotFoundError&) {
+	    report_difference(did, "Document missing");
+	    result = FAIL;
+	    continue;
+	}
+
+	if (doc.get_data() != ref_doc.get_data()) {
+	    report_difference(did, "Document data differs");
+	    result = FAIL;
+	}
+
+	auto t = doc.termlist_begin();
+	auto r = ref_doc.termlist_begin();
+	while (t != doc.termlist_end() || r != ref_doc.termlist_end()) {
+	    if (t == doc.termlist_end() ||
+		(r != ref_doc.termlist_end() && *r < *t)) {
+		report_difference(did, "Term " + *r + " missing");
+		result = FAIL;
+		++r;
+		continue;
+	    }
+	    if (r == ref_doc.termlist_end() || *t < *r) {
+		report_difference(did, "Unexpected term " + *t);
+		result = FAIL;
+		++t;
+		continue;
+	    }
+	    if (t.get_wdf() != r.get_wdf()) {
+		report_difference(did, "Term " + *t + " has wdf " +
+				  to_string(t.get_wdf()) + ", expected " +
+				  to_string(r.get_wdf()));
+		result = FAIL;
+	    }
+	    if (!equal(t.positionlist_begin(), t.positionlist_end(),
+		       r.positionlist_begin(), r.positionlist_end())) {
+		report_difference(did, "Positions of term " + *t + " differ");
+		result = FAIL;
+	    }
+	    ++t;
+	    ++r;
+	}
+
+	if (doc.values_count() != ref_doc.values_count()) {
+	    report_difference(did, "Number of values differs");
+	    result = FAIL;
+	}
+	for (auto v = ref_doc.values_begin(); v != ref_doc.values_end(); ++v) {
+	    if (doc.get_value(v.get_valueno()) != *v) {
+		report_difference(did, "Value slot " +
+				  to_string(v.get_valueno()) + " differs");
+		result = FAIL;
+	    }
+	}
+    }
+
+    // Content cache entries and the spelling data recorded for them are
+    // checked by check_content_cache() instead, since they're only present if
+    // --content-cache was used.
+    auto k = db.metadata_keys_begin();
+    auto r_k = ref.metadata_keys_begin();
+    while (k != db.metadata_keys_end() || r_k != ref.metadata_keys_end()) {
+	if (k != db.metadata_keys_end() && ((*k)[0] == 'C' || (*k)[0] == 'W')) {
+	    ++k;
+	    continue;
+	}
+	if (r_k != ref.metadata_keys_end() &&
+	    ((*r_k)[0] == 'C' || (*r_k)[0] == 'W')) {
+	    ++r_k;
+	    continue;
+	}
+	if (k == db.metadata_keys_end() ||
+	    (r_k != ref.metadata_keys_end() && *r_k < *k)) {
+	    cerr << "error: Metadata key ";
+	    escape(*r_k, cerr);
+	    cerr << " missing\n";
+	    result = FAIL;
+	    ++r_k;
+	    continue;
+	}
+	if (r_k == ref.metadata_keys_end() || *k < *r_k) {
+	    cerr << "error: Unexpected metadata key ";
+	    escape(*k, cerr);
+	    cerr << '\n';
+	    result = FAIL;
+	    ++k;
+	    continue;
+	}
+	if (db.get_metadata(*k) != ref.get_metadata(*k)) {
+	    cerr << "error: Metadata for key ";
+	    escape(*k, cerr);
+	    cerr << " differs\n";
+	    result = FAIL;
+	}
+	++k;
+	++r_k;
+    }
+
+    auto s = db.spellings_begin();
+    auto r = ref.spellings_begin();
+    while (s != db.spellings_end() || r != ref.spellings_end()) {
+	if (s == db.spellings_end() ||
+	    (r != ref.spellings_end() && *r < *s)) {
+	    cerr << "error: Spelling entry " << *r << " missing\n";
+	    result = FAIL;
+	    ++r;
+	    continue;
+	}
+	if (r == ref.spellings_end() || *s < *r) {
+	    cerr << "error: Unexpected spelling entry " << *s << '\n';
+	    result = FAIL;
+	    ++s;
+	    continue;
+	}
+	if (s.get_termfreq() != r.get_termfreq()) {
+	    cerr << "error: Spelling entry " << *s << " has frequency "
+		 << s.get_termfreq() << ", expected " << r.get_termfreq()
+		 << '\n';
+	    result = FAIL;
+	}
+	++s;
+	++r;
+    }
+
+    return result;
+}
+
+/** Check the content cache entries list exactly the documents with each
+ *  content.
+ *
+ *  Also check that spelling data is only recorded for documents which are
+ *  in the content cache.  The check is skipped if there aren't any entries,
+ *  as then --content-cache was never used.
+ */
+static test_result
+check_content_cache(const Xapian::Database& db)
+{
+    map<string, set<Xapian::docid>> entries;
+    for (auto k = db.metadata_keys_begin("C");
+	 k != db.metadata_keys_end("C");
+	 ++k) {
+	auto& dids = entries[*k];
+	istringstream entry(db.get_metadata(*k));
+	Xapian::docid did;
+	while (entry >> did) dids.insert(did);
+    }
+    if (entries.empty()) return PASS;
+
+    map<string, set<Xapian::docid>> expected;
+    for (auto v = db.valuestream_begin(VALUE_MD5);
+	 v != db.valuestream_end(VALUE_MD5);
+	 ++v) {
+	Xapian::docid did = v.get_docid();
+	string key = "C";
+	key += *v;
+	key += db.get_document(did).get_value(VALUE_SIZE);
+	expected[key].insert(did);
+    }
+
+    test_result result = PASS;
+    if (entries != expected) {
+	cerr << "error: Content cache entries don't match the documents\n";
+	result = FAIL;
+    }
+
+    for (auto k = db.metadata_keys_begin("W");
+	 k != db.metadata_keys_end("W");
+	 ++k) {
+	string did_str = (*k).substr(1);
+	Xapian::docid did;
+	bool cached = false;
+	if (parse_unsigned(did_str.c_str(), did)) {
+	    for (auto&& i : expected) {
+		if (i.second.count(did)) {
+		    cached = true;
+		    break;
+		}
+	    }
+	}
+	if (!cached) {
+	    cerr << "error: Spelling data recorded for document #"
+		 << did_str << " which isn't in the content cache\n";
+	    result = FAIL;
+	}
+    }
+    return result;
+}
+
 int
 main(int argc, char** argv)
 {
@@ -387,6 +611,16 @@ main(int argc, char** argv)
 
     Xapian::Database db(argv[1]);
 
+    if (check_content_cache(db) == FAIL)
+	result = FAIL;
+
+    if (argc > 2) {
+	// Compare with a database indexed from the same files.
+	if (compare_databases(db, Xapian::Database(argv[2])) == FAIL)
+	    result = FAIL;
+	return result == FAIL ? 1 : 0;
+    }
+
     index_test();
     for (auto t = db.allterms_begin("U"); t != db.allterms_end("U"); ++t) {
 	const string& term = *t;
@@ -29,6 +29,7 @@
 #include <algorithm>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <random>
 #include <set>
 #include <unordered_map>
@@ -127,6 +128,8 @@ static string error_msg;
 
 static double secs = -1;
 
+static Xapian::doccount dbsize = 0;
+
 static const char DEFAULT_LOG_ENTRY[] =
 	"$or{$env{REMOTE_HOST},$env{REMOTE_ADDR},-}\t"
 	"[$date{$now,%d/%b/%Y:%H:%M:%S} +0000]\t"
@@ -933,7 +936,9 @@ static int percent;
 static double weight;
 static Xapian::doccount collapsed;
 
-static string print_caption(const string& fmt, vector<string>& param);
+struct Template;
+
+static string print_caption(const Template& fmt, vector<string>& param);
 
 enum tagval {
 CMD_,
@@ -1224,66 +1229,104 @@ T(weight,	   0, 0, N, 0), // weight of the current hit
 
 #undef T // Leaving T defined screws up Sun's C++ compiler!
 
-static vector<string> macros;
+// Maps command names to their attributes, including any macros defined with
+// $def.
+static map<string, const struct func_attrib *> func_map;
 
-// Call write() repeatedly until all data is written or we get a
-// non-recoverable error.
-static ssize_t
-write_all(int fd, const char * buf, size_t count)
+// Incremented whenever func_map changes, so that commands in parsed templates
+// which were looked up in an older version of it get looked up again.
+static unsigned func_map_generation = 0;
+
+static void
+init_func_map()
 {
-    while (count) {
-	ssize_t r = write(fd, buf, count);
-	if (rare(r < 0)) {
-	    if (errno == EINTR) continue;
-	    return r;
+    if (func_map.empty()) {
+	for (auto p = func_tab; p->name != NULL; ++p) {
+	    func_map[string(p->name)] = &(p->a);
 	}
-	buf += r;
-	count -= r;
     }
-    return 0;
 }
 
-// mersenne twister for RNG
-static mt19937 rng;
-static bool seed_set = false;
+/// A command invocation in a parsed template.
+struct Command {
+    /// The name of the command.
+    string name;
 
-static string eval(const string& fmt, vector<string>& param);
+    /// Whether the command name was followed by arguments in braces.
+    bool has_args = false;
 
-/** Implements $foreach{} and $map{}. */
-static string
-foreach(const string& list,
-	const string& pat,
-	vector<string>& param,
-	char sep = '\0')
-{
-    string result;
-    string saved_arg0 = std::move(param[0]);
-    string::size_type i = 0, j;
-    while (true) {
-	j = list.find('\t', i);
-	param[0].assign(list, i, j - i);
-	result += eval(pat, param);
-	if (j == string::npos) break;
-	if (sep) result += sep;
-	i = j + 1;
-    }
-    param[0] = std::move(saved_arg0);
-    return result;
-}
+    /// The text between the braces.
+    string arg_text;
 
-static string
-eval(const string& fmt, vector<string>& param)
+    /// Set if the closing brace is missing.
+    string error;
+
+    /// The command's attributes, or NULL if not yet looked up.
+    const func_attrib* func = NULL;
+
+    /// The value of func_map_generation when func was looked up.
+    unsigned generation = 0;
+
+    /// How args were split: -1 not yet, 0 as one argument, 1 at commas.
+    int split_mode = -1;
+
+    /// The unevaluated arguments.
+    vector<string> args;
+
+    /// Parsed versions of args, filled in as they are needed.
+    vector<shared_ptr<const Template>> parsed_args;
+
+    /// Look up the command, throwing if it isn't known.
+    const func_attrib* resolve();
+
+    /// Return argument @a i parsed as a template.
+    shared_ptr<const Template> arg(size_t i);
+};
+
+/** An OmegaScript template parsed into text, parameter references and
+ *  commands.
+ *
+ *  Evaluating the parsed form avoids scanning the template text and looking
+ *  up each command every time, which matters for templates evaluated
+ *  repeatedly (e.g. by $hitlist, $map and macros).
+ */
+struct Template {
+    /// Literal text followed by a parameter, command or error.
+    struct Piece {
+	enum { TEXT, PARAM, COMMAND, ERROR } type;
+
+	/// Literal text to output first.
+	string text;
+
+	/// Parameter number for PARAM.
+	unsigned param = 0;
+
+	/// The command for COMMAND.
+	unique_ptr<Command> command;
+
+	/// The message to throw for ERROR.
+	string error;
+    };
+
+    vector<Piece> pieces;
+};
+
+static void
+parse_template(const string& fmt, Template& tmpl)
 {
-    static map<string, const struct func_attrib *> func_map;
-    if (func_map.empty()) {
-	for (auto p = func_tab; p->name != NULL; ++p) {
-	    func_map[string(p->name)] = &(p->a);
-	}
-    }
-    string res;
+    init_func_map();
+    string text;
+    auto add_piece = [&](decltype(Template::Piece::type) type) {
+	tmpl.pieces.emplace_back();
+	Template::Piece& piece = tmpl.pieces.back();
+	piece.type = type;
+	swap(piece.text, text);
+	return &piece;
+    };
+
     string::size_type p = 0, q;
-    while ((q = fmt.find('$', p)) != string::npos) try {
-	res.append(fmt, p, q - p);
+    while ((q = fmt.find('$', p)) != string::npos) {
+	text.append(fmt, p, q - p);
 	string::size_type code_start = q; // note down for error reporting
 	q++;
 	if (q >= fmt.size()) break;
@@ -1292,19 +1335,19 @@ eval(const string& fmt, vector<string>& param)
 	    // Magic sequences:
 	    // '$$' -> '$', '$(' -> '{', '$)' -> '}', '$.' -> ','
 	    case '$':
-		res += '$';
+		text += '$';
 		p = q + 1;
 		continue;
 	    case '(':
-		res += '{';
+		text += '{';
 		p = q + 1;
 		continue;
 	    case ')':
-		res += '}';
+		text += '}';
 		p = q + 1;
 		continue;
 	    case '.':
-		res += ',';
+		text += ',';
 		p = q + 1;
 		continue;
 	    case '_':
@@ -1312,8 +1355,7 @@ eval(const string& fmt, vector<string>& param)
 		// FALL THRU
 	    case '1': case '2': case '3': case '4': case '5':
 	    case '6': case '7': case '8': case '9':
-		ch -= '0';
-		if (ch < param.size()) res += param[ch];
+		add_piece(Template::Piece::PARAM)->param = ch - '0';
 		p = q + 1;
 		continue;
 	    case 'a': case 'b': case 'c': case 'd': case 'e': case 'f':
@@ -1328,65 +1370,239 @@ eval(const string& fmt, vector<string>& param)
 	    case 'Y': case 'Z':
 	    case '{':
 		break;
-	    default:
+	    default: {
 		string msg = "Unknown $ code in: $";
 		msg.append(fmt, q, string::npos);
-		throw msg;
+		add_piece(Template::Piece::ERROR)->error = std::move(msg);
+		return;
+	    }
 	}
 	p = find_if(fmt.begin() + q, fmt.end(), p_notid) - fmt.begin();
-	string var(fmt, q, p - q);
-	map<string, const struct func_attrib *>::const_iterator func;
-	func = func_map.find(var);
-	if (func == func_map.end()) {
-	    throw "Unknown function '" + var + "'";
-	}
-	vector<string> args;
+	Command* cmd = new Command;
+	add_piece(Template::Piece::COMMAND)->command.reset(cmd);
+	cmd->name.assign(fmt, q, p - q);
 	if (fmt[p] == '{') {
+	    cmd->has_args = true;
 	    q = p + 1;
 	    int nest = 1;
 	    while (true) {
-		p = fmt.find_first_of(",{}", p + 1);
-		if (p == string::npos)
-		    throw "missing } in " + fmt.substr(code_start);
+		p = fmt.find_first_of("{}", p + 1);
+		if (p == string::npos) {
+		    cmd->error = "missing } in " + fmt.substr(code_start);
+		    return;
+		}
 		if (fmt[p] == '{') {
 		    ++nest;
-		} else {
-		    if (nest == 1) {
-			// should we split the args
-			if (func->second->minargs != N) {
-			    args.push_back(fmt.substr(q, p - q));
-			    q = p + 1;
-			}
-		    }
-		    if (fmt[p] == '}' && --nest == 0) break;
+		} else if (--nest == 0) {
+		    break;
 		}
 	    }
-	    if (func->second->minargs == N)
-		args.push_back(fmt.substr(q, p - q));
+	    cmd->arg_text.assign(fmt, q, p - q);
 	    ++p;
 	}
+    }
+
+    text.append(fmt, p, string::npos);
+    if (!text.empty()) add_piece(Template::Piece::TEXT);
+}
+
+const func_attrib*
+Command::resolve()
+{
+    if (func && generation == func_map_generation) return func;
+
+    auto i = func_map.find(name);
+    if (i == func_map.end()) {
+	throw "Unknown function '" + name + "'";
+    }
+    if (!error.empty()) throw error;
+
+    func = i->second;
+    generation = func_map_generation;
+
+    // Commented out code isn't split into arguments.
+    int split = (func->minargs != N);
+    if (split == split_mode) return func;
+    split_mode = split;
+
+    args.clear();
+    parsed_args.clear();
+    if (has_args) {
+	if (!split) {
+	    args.push_back(arg_text);
+	} else {
+	    // Split at commas which aren't inside nested braces.
+	    string::size_type p = 0, q = 0;
+	    int nest = 0;
+	    while ((p = arg_text.find_first_of(",{}", p)) != string::npos) {
+		if (arg_text[p] == '{') {
+		    ++nest;
+		} else if (arg_text[p] == '}') {
+		    --nest;
+		} else if (nest == 0) {
+		    args.push_back(arg_text.substr(q, p - q));
+		    q = p + 1;
+		}
+		++p;
+	    }
+	    args.push_back(arg_text.substr(q));
+	}
+    }
+    parsed_args.resize(args.size());
+    return func;
+}
+
+shared_ptr<const Template>
+Command::arg(size_t i)
+{
+    if (!parsed_args[i]) {
+	auto tmpl = make_shared<Template>();
+	parse_template(args[i], *tmpl);
+	parsed_args[i] = std::move(tmpl);
+    }
+    return parsed_args[i];
+}
+
+static vector<shared_ptr<const Template>> macros;
+
+// Call write() repeatedly until all data is written or we get a
+// non-recoverable error.
+static ssize_t
+write_all(int fd, const char * buf, size_t count)
+{
+    while (count) {
+	ssize_t r = write(fd, buf, count);
+	if (rare(r < 0)) {
+	    if (errno == EINTR) continue;
+	    return r;
+	}
+	buf += r;
+	count -= r;
+    }
+    return 0;
+}
+
+/// A CDB file opened by $lookup.
+struct OpenCdb {
+    int fd;
+    struct cdb cdb;
+    dev_t dev;
+    ino_t ino;
+    time_t mtime;
+};
+
+// CDB files are kept open so that a process handling several requests only
+// opens each once.
+static map<string, OpenCdb> open_cdbs;
+
+static struct cdb*
+open_cdb(const string& cdbfile)
+{
+    struct stat sb;
+    bool exists = (stat(cdbfile.c_str(), &sb) == 0);
+    auto it = open_cdbs.find(cdbfile);
+    if (it != open_cdbs.end()) {
+	OpenCdb& c = it->second;
+	if (exists &&
+	    c.dev == sb.st_dev && c.ino == sb.st_ino && c.mtime == sb.st_mtime)
+	    return &c.cdb;
+	// The file has been replaced or removed since we opened it.
+	cdb_free(&c.cdb);
+	close(c.fd);
+	open_cdbs.erase(it);
+    }
+    if (!exists) return NULL;
+
+    int fd = open(cdbfile.c_str(), O_RDONLY);
+    if (fd == -1) return NULL;
+    OpenCdb c;
+    if (fstat(fd, &sb) < 0 || cdb_init(&c.cdb, fd) < 0) {
+	close(fd);
+	return NULL;
+    }
+    c.fd = fd;
+    c.dev = sb.st_dev;
+    c.ino = sb.st_ino;
+    c.mtime = sb.st_mtime;
+    return &open_cdbs.emplace(cdbfile, c).first->second.cdb;
+}
+
+// mersenne twister for RNG
+static mt19937 rng;
+static bool seed_set = false;
+
+static string eval(const Template& fmt, vector<string>& param);
+
+static string eval(const string& fmt, vector<string>& param);
+
+/** Implements $foreach{} and $map{}. */
+static string
+foreach(const string& list,
+	const Template& pat,
+	vector<string>& param,
+	char sep = '\0')
+{
+    string result;
+    string saved_arg0 = std::move(param[0]);
+    string::size_type i = 0, j;
+    while (true) {
+	j = list.find('\t', i);
+	param[0].assign(list, i, j - i);
+	result += eval(pat, param);
+	if (j == string::npos) break;
+	if (sep) result += sep;
+	i = j + 1;
+    }
+    param[0] = std::move(saved_arg0);
+    return result;
+}
 
-	if (func->second->minargs != N) {
-	    if (int(args.size()) < func->second->minargs)
+static string
+eval(const Template& fmt, vector<string>& param)
+{
+    string res;
+    for (auto&& piece : fmt.pieces) try {
+	res += piece.text;
+	switch (piece.type) {
+	    case Template::Piece::TEXT:
+		continue;
+	    case Template::Piece::PARAM:
+		if (piece.param < param.size()) res += param[piece.param];
+		continue;
+	    case Template::Piece::ERROR:
+		throw piece.error;
+	    case Template::Piece::COMMAND:
+		break;
+	}
+	Command& cmd = *piece.command;
+	const func_attrib* func = cmd.resolve();
+	const string& var = cmd.name;
+	vector<string> args;
+	if (func->minargs != N) {
+	    if (int(cmd.args.size()) < func->minargs)
 		throw "too few arguments to $" + var;
-	    if (func->second->maxargs != N &&
-		int(args.size()) > func->second->maxargs)
+	    if (func->maxargs != N &&
+		int(cmd.args.size()) > func->maxargs)
 		throw "too many arguments to $" + var;
 
 	    vector<string>::size_type n;
-	    if (func->second->evalargs != N)
-		n = func->second->evalargs;
+	    if (func->evalargs != N)
+		n = func->evalargs;
 	    else
-		n = args.size();
+		n = cmd.args.size();
 
+	    args.reserve(cmd.args.size());
 	    for (vector<string>::size_type j = 0; j < n; ++j)
-		args[j] = eval(args[j], param);
+		args.push_back(eval(*cmd.arg(j), param));
+	    args.insert(args.end(), cmd.args.begin() + n, cmd.args.end());
+	} else {
+	    args = cmd.args;
 	}
-	if (func->second->ensure == 'Q' || func->second->ensure == 'M')
+	if (func->ensure == 'Q' || func->ensure == 'M')
 	    ensure_query_parsed();
-	if (func->second->ensure == 'M') ensure_match();
+	if (func->ensure == 'M') ensure_match();
 	string value;
-	switch (func->second->tag) {
+	switch (func->tag) {
 	    case CMD_:
 		break;
 	    case CMD_add: {
@@ -1426,8 +1642,8 @@ eval(const string& fmt, vector<string>& param)
 	    }
 	    case CMD_and: {
 		value = "true";
-		for (auto&& arg : args) {
-		    if (eval(arg, param).empty()) {
+		for (size_t i = 0; i < args.size(); ++i) {
+		    if (eval(*cmd.arg(i), param).empty()) {
 			value.resize(0);
 			break;
 		    }
@@ -1513,11 +1729,11 @@ eval(const string& fmt, vector<string>& param)
 		for (size_t i = 0; i < args.size(); i += 2) {
 		    if (i == args.size() - 1) {
 			// Handle optional "else" value.
-			value = eval(args[i], param);
+			value = eval(*cmd.arg(i), param);
 			break;
 		    }
-		    if (!eval(args[i], param).empty()) {
-			value = eval(args[i + 1], param);
+		    if (!eval(*cmd.arg(i), param).empty()) {
+			value = eval(*cmd.arg(i + 1), param);
 			break;
 		    }
 		}
@@ -1559,12 +1775,10 @@ eval(const string& fmt, vector<string>& param)
 	    case CMD_dbname:
 		value = dbname;
 		break;
-	    case CMD_dbsize: {
-		static Xapian::doccount dbsize;
+	    case CMD_dbsize:
 		if (!dbsize) dbsize = db.get_doccount();
 		value = str(dbsize);
 		break;
-	    }
 	    case CMD_def: {
 		func_attrib *fa = new func_attrib;
 		fa->tag = CMD_MACRO + macros.size();
@@ -1573,8 +1787,9 @@ eval(const string& fmt, vector<string>& param)
 		fa->evalargs = N; // FIXME: or 0?
 		fa->ensure = 0;
 
-		macros.push_back(args[1]);
+		macros.push_back(cmd.arg(1));
 		func_map[args[0]] = fa;
+		++func_map_generation;
 		break;
 	    }
 	    case CMD_defaultop:
@@ -1713,7 +1928,7 @@ eval(const string& fmt, vector<string>& param)
 		break;
 	    case CMD_foreach:
 		if (!args[0].empty()) {
-		    value = foreach(args[0], args[1], param);
+		    value = foreach(args[0], *cmd.arg(1), param);
 		}
 		break;
 	    case CMD_freq: {
@@ -1820,7 +2035,7 @@ eval(const string& fmt, vector<string>& param)
 #endif
 		auto save_hit_no = hit_no;
 		for (hit_no = topdoc; hit_no < last; ++hit_no)
-		    value += print_caption(args[0], param);
+		    value += print_caption(*cmd.arg(0), param);
 		hit_no = save_hit_no;
 		break;
 	    }
@@ -1862,9 +2077,9 @@ eval(const string& fmt, vector<string>& param)
 		break;
 	    case CMD_if:
 		if (args.size() > 1 && !args[0].empty())
-		    value = eval(args[1], param);
+		    value = eval(*cmd.arg(1), param);
 		else if (args.size() > 2)
-		    value = eval(args[2], param);
+		    value = eval(*cmd.arg(2), param);
 		break;
 	    case CMD_include: {
 		if (args.size() == 1) {
@@ -1901,7 +2116,7 @@ eval(const string& fmt, vector<string>& param)
 			value += '"';
 		    } else {
 			new_args[0] = std::move(elt);
-			value += eval(args[1], new_args);
+			value += eval(*cmd.arg(1), new_args);
 		    }
 		    if (j == string::npos) break;
 		    value += ',';
@@ -1937,14 +2152,14 @@ eval(const string& fmt, vector<string>& param)
 				    string key(k, prefix.size());
 				    if (args.size() > 1 && !args[1].empty()) {
 					new_args[0] = std::move(key);
-					key = eval(args[1], new_args);
+					key = eval(*cmd.arg(1), new_args);
 				    }
 				    return key;
 				},
 				[&](const string& v) {
 				    if (args.size() > 2 && !args[2].empty()) {
 					new_args[0] = v;
-					return eval(args[2], new_args);
+					return eval(*cmd.arg(2), new_args);
 				    }
 				    string r(1, '"');
 				    string elt = v;
@@ -2054,26 +2269,16 @@ eval(const string& fmt, vector<string>& param)
 	    }
 	    case CMD_lookup: {
 		if (!vet_filename(args[0])) break;
-		string cdbfile = cdb_dir + args[0];
-		int fd = open(cdbfile.c_str(), O_RDONLY);
-		if (fd == -1) break;
-
-		struct cdb cdb;
-		if (cdb_init(&cdb, fd) < 0) {
-		    close(fd);
-		    break;
-		}
+		struct cdb* cdb = open_cdb(cdb_dir + args[0]);
+		if (!cdb) break;
 
-		if (cdb_find(&cdb, args[1].data(), args[1].length()) > 0) {
-		    size_t datalen = cdb_datalen(&cdb);
-		    const void *dat = cdb_get(&cdb, datalen, cdb_datapos(&cdb));
+		if (cdb_find(cdb, args[1].data(), args[1].length()) > 0) {
+		    size_t datalen = cdb_datalen(cdb);
+		    const void *dat = cdb_get(cdb, datalen, cdb_datapos(cdb));
 		    if (dat) {
 			value.assign(static_cast<const char *>(dat), datalen);
 		    }
 		}
-
-		cdb_free(&cdb);
-		close(fd); // FIXME: cache fds?
 		break;
 	    }
 	    case CMD_lower:
@@ -2085,7 +2290,7 @@ eval(const string& fmt, vector<string>& param)
 		break;
 	    case CMD_map:
 		if (!args[0].empty()) {
-		    value = foreach(args[0], args[1], param, '\t');
+		    value = foreach(args[0], *cmd.arg(1), param, '\t');
 		}
 		break;
 	    case CMD_match:
@@ -2182,8 +2387,8 @@ eval(const string& fmt, vector<string>& param)
 		}
 		break;
 	    case CMD_or: {
-		for (auto&& arg : args) {
-		    value = eval(arg, param);
+		for (size_t i = 0; i < args.size(); ++i) {
+		    value = eval(*cmd.arg(i), param);
 		    if (!value.empty()) break;
 		}
 		break;
@@ -2537,11 +2742,11 @@ eval(const string& fmt, vector<string>& param)
 		for (size_t i = 1; i < args.size(); i += 2) {
 		    if (i == args.size() - 1) {
 			// Handle optional "else" value.
-			value = eval(args[i], param);
+			value = eval(*cmd.arg(i), param);
 			break;
 		    }
-		    if (val == eval(args[i], param)) {
-			value = eval(args[i + 1], param);
+		    if (val == eval(*cmd.arg(i), param)) {
+			value = eval(*cmd.arg(i + 1), param);
 			break;
 		    }
 		}
@@ -2758,10 +2963,10 @@ eval(const string& fmt, vector<string>& param)
 		break;
 	    default: {
 		args.insert(args.begin(), param[0]);
-		int macro_no = func->second->tag - CMD_MACRO;
+		int macro_no = func->tag - CMD_MACRO;
 		assert(macro_no >= 0 && unsigned(macro_no) < macros.size());
 		// throw "Unknown function '" + var + "'";
-		value = eval(macros[macro_no], args);
+		value = eval(*macros[macro_no], args);
 		break;
 	    }
 	}
@@ -2772,10 +2977,53 @@ eval(const string& fmt, vector<string>& param)
 	error_msg = e.get_description();
     }
 
-    res.append(fmt, p, string::npos);
     return res;
 }
 
+static string
+eval(const string& fmt, vector<string>& param)
+{
+    Template tmpl;
+    parse_template(fmt, tmpl);
+    return eval(tmpl, param);
+}
+
+/// A template file which has been read and parsed.
+struct LoadedTemplate {
+    time_t mtime;
+    off_t size;
+    shared_ptr<const Template> parsed;
+};
+
+// Templates read so far, so a process handling several requests only rereads
+// and reparses a template if it has been modified.
+static map<string, LoadedTemplate> loaded_templates;
+
+static shared_ptr<const Template>
+load_template(const string& file)
+{
+    struct stat sb;
+    if (stat(file.c_str(), &sb) < 0) {
+	loaded_templates.erase(file);
+	return nullptr;
+    }
+    auto it = loaded_templates.find(file);
+    if (it == loaded_templates.end() ||
+	it->second.mtime != sb.st_mtime ||
+	it->second.size != sb.st_size) {
+	string fmt;
+	if (!load_file(file, fmt)) {
+	    if (it != loaded_templates.end()) loaded_templates.erase(it);
+	    return nullptr;
+	}
+	auto tmpl = make_shared<Template>();
+	parse_template(fmt, *tmpl);
+	LoadedTemplate t{sb.st_mtime, sb.st_size, std::move(tmpl)};
+	it = loaded_templates.insert_or_assign(file, std::move(t)).first;
+    }
+    return it->second.parsed;
+}
+
 static string
 eval_file(const string& fmtfile, bool* p_not_found)
 {
@@ -2783,12 +3031,12 @@ eval_file(const string& fmtfile, bool* p_not_found)
     int eno = -1;
     if (vet_filename(fmtfile)) {
 	string file = template_dir + fmtfile;
-	string fmt;
 	errno = 0;
-	if (load_file(file, fmt)) {
+	auto tmpl = load_template(file);
+	if (tmpl) {
 	    vector<string> noargs;
 	    noargs.resize(1);
-	    return eval(fmt, noargs);
+	    return eval(*tmpl, noargs);
 	}
 	eno = errno;
     }
@@ -2863,7 +3111,7 @@ pretty_term(string term)
 }
 
 static string
-print_caption(const string& fmt, vector<string>& param)
+print_caption(const Template& fmt, vector<string>& param)
 {
     q0 = *(mset[hit_no]);
 
@@ -2897,6 +3145,47 @@ parse_omegascript()
     }
 }
 
+void
+reset_query_state()
+{
+    subdbs.clear();
+    query_parsed = false;
+    done_query = false;
+    last = 0;
+    topdoc = 0;
+    mset = Xapian::MSet();
+    rset = Xapian::RSet();
+    ticked.clear();
+    query = Xapian::Query();
+    default_op = Xapian::Query::OP_AND;
+    date_filter_set = false;
+    date_filter = Xapian::Query();
+    qp = Xapian::QueryParser();
+    delete stemmer;
+    stemmer = NULL;
+    termset.clear();
+    termprefix_to_userprefix.clear();
+    queryterms.resize(0);
+    error_msg.resize(0);
+    secs = -1;
+    dbsize = 0;
+    query_strings.clear();
+    filter_map.clear();
+    neg_filters.clear();
+    fields = CachedFields();
+    seed_set = false;
+
+    // Drop any macros defined by $def, which may have replaced built-in
+    // commands.
+    for (auto&& i : func_map) {
+	if (i.second->tag >= CMD_MACRO) delete i.second;
+    }
+    func_map.clear();
+    init_func_map();
+    ++func_map_generation;
+    macros.clear();
+}
+
 static void
 ensure_query_parsed()
 {
@@ -69,6 +69,9 @@ void add_query_string(const std::string& prefix, const std::string& s);
 
 void parse_omegascript();
 
+/// Reset per-request state so that another request can be handled.
+void reset_query_state();
+
 std::string pretty_term(std::string term);
 
 class OmegaExpandDecider : public Xapian::ExpandDecider {
@@ -0,0 +1,238 @@
+/** @file
+ * @brief Serve omega requests over the SCGI protocol
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "scgi.h"
+
+#ifndef __WIN32__
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "safesyssocket.h"
+#include "safesysstat.h"
+#include "safeunistd.h"
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "cgiparam.h"
+#include "omega.h"
+#include "parseint.h"
+#include "stringutils.h"
+
+using namespace std;
+
+/// Upper limit on the size of the request headers we'll accept.
+static const size_t SCGI_MAX_HEADER_SIZE = 1024 * 1024;
+
+/// Upper limit on the size of a request body we'll accept.
+static const size_t SCGI_MAX_CONTENT_LENGTH = 1024 * 1024;
+
+/** Timeout in seconds for each read from a client.
+ *
+ *  We handle one request at a time, so without this a client which stops
+ *  sending would stop us serving anyone else.
+ */
+static const int SCGI_READ_TIMEOUT = 30;
+
+/// Response sent for a request with a body larger than we'll accept.
+static const char SCGI_TOO_LARGE_RESPONSE[] =
+    "Status: 413 Request Entity Too Large\r\n"
+    "Content-Type: text/plain\r\n"
+    "\r\n"
+    "Request too large\r\n";
+
+// Call read() repeatedly until all data is read or we get an error or EOF.
+//
+// A read which times out is an error.
+static bool
+read_all(int fd, char* buf, size_t count)
+{
+    while (count) {
+	ssize_t r = read(fd, buf, count);
+	if (rare(r <= 0)) {
+	    if (r < 0 && errno == EINTR) continue;
+	    return false;
+	}
+	buf += r;
+	count -= r;
+    }
+    return true;
+}
+
+/** Read the request headers from an SCGI connection.
+ *
+ *  The headers are sent as a netstring of alternating NUL-terminated names
+ *  and values, e.g.: 24:CONTENT_LENGTH<NUL>0<NUL>SCGI<NUL>1<NUL>,
+ */
+static bool
+read_headers(int fd, vector<pair<string, string>>& headers)
+{
+    size_t len = 0;
+    while (true) {
+	char ch;
+	if (!read_all(fd, &ch, 1)) return false;
+	if (ch == ':') break;
+	if (!C_isdigit(ch)) return false;
+	len = len * 10 + (ch - '0');
+	if (len > SCGI_MAX_HEADER_SIZE) return false;
+    }
+
+    string data(len + 1, '\0');
+    if (!read_all(fd, &data[0], len + 1) || data[len] != ',')
+	return false;
+    data.resize(len);
+
+    size_t i = 0;
+    while (i < len) {
+	size_t name_end = data.find('\0', i);
+	if (name_end == string::npos) return false;
+	size_t value_end = data.find('\0', name_end + 1);
+	if (value_end == string::npos) return false;
+	headers.emplace_back(data.substr(i, name_end - i),
+			     data.substr(name_end + 1,
+					 value_end - (name_end + 1)));
+	i = value_end + 1;
+    }
+    return true;
+}
+
+void
+scgi_serve(const char* socket_path, void (*handler)())
+{
+    struct sockaddr_un addr;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+	cerr << PROGRAM_NAME ": Socket path too long: " << socket_path
+	     << endl;
+	return;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+	cerr << PROGRAM_NAME ": Couldn't create socket: " << strerror(errno)
+	     << endl;
+	return;
+    }
+
+    // Replace a socket left behind by a previous instance, but don't remove
+    // anything else which happens to be at this path.
+    struct stat sb;
+    if (lstat(socket_path, &sb) == 0 && S_ISSOCK(sb.st_mode))
+	unlink(socket_path);
+
+    if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+	listen(listener, SOMAXCONN) < 0) {
+	cerr << PROGRAM_NAME ": Couldn't listen on " << socket_path << ": "
+	     << strerror(errno) << endl;
+	close(listener);
+	return;
+    }
+
+    // A client going away mid-response shouldn't kill the server.
+    signal(SIGPIPE, SIG_IGN);
+
+    int saved_stdout = dup(1);
+
+    // Environment variables set for the previous request.
+    vector<string> env_names;
+
+    while (true) {
+	int fd = accept(listener, NULL, NULL);
+	if (fd < 0) {
+	    if (errno == EINTR || errno == ECONNABORTED) continue;
+	    cerr << PROGRAM_NAME ": accept() failed: " << strerror(errno)
+		 << endl;
+	    break;
+	}
+
+	struct timeval timeout;
+	timeout.tv_sec = SCGI_READ_TIMEOUT;
+	timeout.tv_usec = 0;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO,
+		   reinterpret_cast<char*>(&timeout), sizeof(timeout));
+
+	vector<pair<string, string>> headers;
+	if (!read_headers(fd, headers)) {
+	    close(fd);
+	    continue;
+	}
+
+	for (auto&& name : env_names) {
+	    unsetenv(name.c_str());
+	}
+	env_names.clear();
+
+	size_t content_length = 0;
+	for (auto&& header : headers) {
+	    if (header.first == "CONTENT_LENGTH") {
+		if (!parse_unsigned(header.second.c_str(), content_length))
+		    content_length = 0;
+	    }
+	    setenv(header.first.c_str(), header.second.c_str(), 1);
+	    env_names.push_back(std::move(header.first));
+	}
+
+	const char* method = getenv("REQUEST_METHOD");
+	if (method && *method == 'P') {
+	    if (content_length > SCGI_MAX_CONTENT_LENGTH) {
+		if (write(fd, SCGI_TOO_LARGE_RESPONSE,
+			  sizeof(SCGI_TOO_LARGE_RESPONSE) - 1) < 0) {
+		    // The client has gone away, so there's nothing to do.
+		}
+		close(fd);
+		continue;
+	    }
+	    string body(content_length, '\0');
+	    if (!read_all(fd, &body[0], content_length)) {
+		close(fd);
+		continue;
+	    }
+	    decode_post(body);
+	} else {
+	    decode_get();
+	}
+
+	// Send the response to the client.
+	dup2(fd, 1);
+	close(fd);
+	handler();
+	cout.flush();
+	fflush(stdout);
+	dup2(saved_stdout, 1);
+
+	// Writing to a client which went away will have set error flags.
+	cout.clear();
+	clearerr(stdout);
+    }
+
+    close(listener);
+}
+
+#endif
@@ -0,0 +1,38 @@
+/** @file
+ * @brief Serve omega requests over the SCGI protocol
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef OMEGA_INCLUDED_SCGI_H
+#define OMEGA_INCLUDED_SCGI_H
+
+/** Serve requests using SCGI on a Unix domain socket.
+ *
+ *  For each connection the request headers are exported as environment
+ *  variables (as a CGI program would see them), the CGI parameters are
+ *  decoded into cgi_params, and then @a handler is called with standard
+ *  output redirected to the connection.
+ *
+ *  This function only returns if the socket can't be set up.
+ *
+ *  @param socket_path	Filename of the socket to listen on.  An existing
+ *			socket at this path is replaced.
+ *  @param handler	Function to call to process each request.
+ */
+void scgi_serve(const char* socket_path, void (*handler)());
+
+#endif // OMEGA_INCLUDED_SCGI_H
@@ -32,17 +32,20 @@
 #include <xapian.h>
 
 #include <algorithm>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <list>
 #include <map>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <unordered_set>
 #include <vector>
 #include <cstring>
 
 #include <cerrno>
+#include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <ctime>
@@ -54,12 +57,15 @@
 #include "htmlparser.h"
 #include "loadfile.h"
 #include "parseint.h"
+#include "safesyswait.h"
+#include "safeunistd.h"
 #include "setenv.h"
 #include "str.h"
 #include "stringutils.h"
 #include "timegm.h"
 #include "utf8truncate.h"
 #include "values.h"
+#include "worker_comms.h"
 
 #ifndef HAVE_STRPTIME
 #include "portability/strptime.h"
@@ -94,6 +100,30 @@ static bool unique_unused;
 /// Track if the current record is being skipping.
 static bool skipping_record = false;
 
+#ifdef HAVE_FORK
+/// In a worker process, the pipe to send results back to the parent on.
+static FILE* worker_out = NULL;
+
+/// In a worker process, track if the current field has the SPELL action.
+static bool spell_field = false;
+
+/** In a worker process, used to find the spellings to add for a record.
+ *
+ *  Only the parent process can add spellings to the database, so a worker
+ *  indexes the words which would be added without stemming or positions -
+ *  each term's wdf is then the number of times to add it.
+ */
+static Xapian::TermGenerator spelling_words;
+
+static void
+note_spellings(const string& text, const string& prefix)
+{
+    // The TermGenerator only adds spellings for unprefixed terms.
+    if (spell_field && prefix.empty())
+	spelling_words.index_text_without_positions(text);
+}
+#endif
+
 static inline bool
 prefix_needs_colon(const string & prefix, unsigned ch)
 {
@@ -989,13 +1019,12 @@ bad_hex_digit:
 static bool
 run_actions(vector<Action>::const_iterator action_it,
 	    vector<Action>::const_iterator action_end,
-	    Xapian::WritableDatabase& database,
 	    Xapian::TermGenerator& indexer,
 	    const string& old_value,
 	    bool& this_field_is_content, Xapian::Document& doc,
 	    map<string, list<string>>& fields,
 	    string& field, const char* fname,
-	    size_t line_no, Xapian::docid& docid)
+	    size_t line_no, vector<string>& unique_terms)
 {
     string value = old_value;
     while (action_it != action_end) {
@@ -1022,6 +1051,9 @@ run_actions(vector<Action>::const_iterator action_it,
 		indexer.index_text(value,
 				   action.get_num_arg(),
 				   action.get_string_arg());
+#ifdef HAVE_FORK
+		note_spellings(value, action.get_string_arg());
+#endif
 		break;
 	    case Action::INDEXNOPOS:
 		// No positional information so phrase searching won't work.
@@ -1029,6 +1061,9 @@ run_actions(vector<Action>::const_iterator action_it,
 		indexer.index_text_without_positions(value,
 						     action.get_num_arg(),
 						     action.get_string_arg());
+#ifdef HAVE_FORK
+		note_spellings(value, action.get_string_arg());
+#endif
 		break;
 	    case Action::BOOLEAN: {
 		// Do nothing if there's no text.
@@ -1114,6 +1149,12 @@ run_actions(vector<Action>::const_iterator action_it,
 		utf8_truncate(value, action.get_num_arg());
 		break;
 	    case Action::SPELL:
+#ifdef HAVE_FORK
+		if (worker_out) {
+		    spell_field = true;
+		    break;
+		}
+#endif
 		indexer.set_flags(indexer.FLAG_SPELLING);
 		break;
 	    case Action::SPLIT: {
@@ -1142,23 +1183,23 @@ run_actions(vector<Action>::const_iterator action_it,
 				if (j > 0) {
 				    string val(value, 0, j);
 				    run_actions(action_it, split_end,
-						database, indexer,
+						indexer,
 						val,
 						this_field_is_content, doc,
 						fields,
 						field, fname, line_no,
-						docid);
+						unique_terms);
 				}
 			    } else if (i != j) {
 				string val(value, i, j - i);
 				if (!seen.get() || seen->insert(val).second) {
 				    run_actions(action_it, split_end,
-						database, indexer,
+						indexer,
 						val,
 						this_field_is_content, doc,
 						fields,
 						field, fname, line_no,
-						docid);
+						unique_terms);
 				}
 			    }
 			    if (j == string::npos) break;
@@ -1172,23 +1213,23 @@ run_actions(vector<Action>::const_iterator action_it,
 				if (j > 0) {
 				    string val(value, 0, j);
 				    run_actions(action_it, split_end,
-						database, indexer,
+						indexer,
 						val,
 						this_field_is_content, doc,
 						fields,
 						field, fname, line_no,
-						docid);
+						unique_terms);
 				}
 			    } else if (i != j) {
 				string val(value, i, j - i);
 				if (!seen.get() || seen->insert(val).second) {
 				    run_actions(action_it, split_end,
-						database, indexer,
+						indexer,
 						val,
 						this_field_is_content, doc,
 						fields,
 						field, fname, line_no,
-						docid);
+						unique_terms);
 				}
 			    }
 			    if (j == string::npos) break;
@@ -1226,10 +1267,10 @@ run_actions(vector<Action>::const_iterator action_it,
 
 		    for (auto&& val : split_values) {
 			run_actions(action_it, split_end,
-				    database, indexer, val,
+				    indexer, val,
 				    this_field_is_content, doc, fields,
 				    field, fname, line_no,
-				    docid);
+				    unique_terms);
 		    }
 		}
 
@@ -1302,10 +1343,7 @@ run_actions(vector<Action>::const_iterator action_it,
 		string t = action.get_string_arg();
 		if (prefix_needs_colon(t, value[0])) t += ':';
 		t += value;
-		Xapian::PostingIterator p = database.postlist_begin(t);
-		if (p != database.postlist_end(t)) {
-		    docid = *p;
-		}
+		unique_terms.push_back(std::move(t));
 		break;
 	    }
 	    case Action::VALUE:
@@ -1441,6 +1479,386 @@ run_actions(vector<Action>::const_iterator action_it,
     return true;
 }
 
+/// A field from an input record, with any continuation lines appended.
+struct RecordField {
+    string name;
+    string value;
+    /// The line number to report in any diagnostics.
+    size_t line_no;
+};
+
+/// The result of running the index script actions on a record.
+struct IndexedRecord {
+    /// Set if the record is to be skipped.
+    bool skip = false;
+
+    /// Set if any fields (other than unique identifiers) were seen.
+    bool seen_content = false;
+
+    /// The document built from the record.
+    Xapian::Document doc;
+
+    /// The terms from any UNIQUE actions, in the order the actions ran.
+    vector<string> unique_terms;
+
+    /// The field values to store in the document data.
+    map<string, list<string>> fields;
+};
+
+static void
+start_record(Xapian::TermGenerator& indexer, IndexedRecord& result)
+{
+    indexer.set_document(result.doc);
+    skipping_record = false;
+    unique_unused = index_spec_uses_unique;
+}
+
+static void
+index_field(RecordField& field, const char* fname,
+	    Xapian::TermGenerator& indexer, IndexedRecord& result)
+{
+    if (skipping_record) return;
+
+    // Default to not indexing spellings.
+    indexer.set_flags(Xapian::TermGenerator::flags(0));
+#ifdef HAVE_FORK
+    spell_field = false;
+#endif
+
+    bool this_field_is_content = true;
+    const vector<Action>& v = index_spec[field.name];
+    run_actions(v.begin(), v.end(),
+		indexer, field.value,
+		this_field_is_content, result.doc, result.fields,
+		field.name, fname, field.line_no,
+		result.unique_terms);
+    if (this_field_is_content) result.seen_content = true;
+}
+
+static void
+finish_record(const char* fname, size_t line_no, IndexedRecord& result)
+{
+    if (unique_unused) {
+	enum diag_type diag = DIAG_WARN;
+	switch (unique_missing) {
+	  case UNIQUE_ERROR:
+	    diag = DIAG_ERROR;
+	    /* FALLTHRU */
+	  case UNIQUE_WARN_NEW:
+	  case UNIQUE_WARN_SKIP:
+	    report_location(diag, fname, line_no);
+	    cerr << "UNIQUE action unused in this record\n";
+	  default:
+	    break;
+	}
+	switch (unique_missing) {
+	  case UNIQUE_ERROR:
+	    exit(1);
+	  case UNIQUE_SKIP:
+	  case UNIQUE_WARN_SKIP:
+	    skipping_record = true;
+	    break;
+	  case UNIQUE_NEW:
+	  case UNIQUE_WARN_NEW:
+	    break;
+	}
+    }
+
+    result.skip = skipping_record;
+    if (result.skip || !result.seen_content) return;
+
+    string data;
+    for (auto&& i : result.fields) {
+	for (auto&& field_val : i.second) {
+	    data += i.first;
+	    data += '=';
+	    data += field_val;
+	    data += '\n';
+	}
+    }
+
+    // Put the data in the document
+    result.doc.set_data(data);
+}
+
+#ifdef HAVE_FORK
+static void
+index_record(vector<RecordField>& record, const char* fname, size_t line_no,
+	     Xapian::TermGenerator& indexer, IndexedRecord& result)
+{
+    start_record(indexer, result);
+    for (auto&& field : record) {
+	index_field(field, fname, indexer, result);
+    }
+    finish_record(fname, line_no, result);
+}
+#endif
+
+static void
+add_record(Xapian::WritableDatabase& database, const IndexedRecord& record)
+{
+    if (record.skip) {
+	++skipcount;
+	return;
+    }
+
+    // If a document already exists with a unique term, this record replaces
+    // it.
+    Xapian::docid docid = 0;
+    for (auto&& term : record.unique_terms) {
+	Xapian::PostingIterator p = database.postlist_begin(term);
+	if (p != database.postlist_end(term)) {
+	    docid = *p;
+	}
+    }
+
+    if (!record.seen_content) {
+	// We haven't seen any fields (other than unique identifiers)
+	// so the document is to be deleted.
+	if (docid) {
+	    database.delete_document(docid);
+	    if (verbose) cout << "Del: " << docid << '\n';
+	    ++delcount;
+	}
+	return;
+    }
+
+    // Add the document to the database
+    if (docid) {
+	database.replace_document(docid, record.doc);
+	if (verbose) cout << "Replace: " << docid << '\n';
+	++repcount;
+    } else {
+	docid = database.add_document(record.doc);
+	if (verbose) cout << "Add: " << docid << '\n';
+	++addcount;
+    }
+}
+
+#ifdef HAVE_FORK
+/// A subprocess which runs the index script actions on records.
+struct Worker {
+    pid_t pid;
+    FILE* to_worker;
+    FILE* from_worker;
+};
+
+/// Worker processes (if --jobs was used).
+static vector<Worker> workers;
+
+/// Workers with a record in progress, in input order.
+static deque<Worker*> busy_workers;
+
+/// The next worker to send a record to.
+static size_t next_worker = 0;
+
+/// In a worker process, messages for the current record.
+static ostringstream worker_messages;
+
+// Called if a worker process calls exit() because of an error in a record.
+static void
+report_worker_error()
+{
+    // Pass on the messages so the parent can report them in order.
+    putc('X', worker_out);
+    write_string(worker_out, worker_messages.str());
+    fflush(worker_out);
+}
+
+[[noreturn]]
+static void
+run_worker(FILE* in, Xapian::TermGenerator& indexer)
+{
+    atexit(report_worker_error);
+    cerr.rdbuf(worker_messages.rdbuf());
+
+    Xapian::Document spellings;
+    spelling_words.set_document(spellings);
+
+    string fname;
+    while (read_string(in, fname)) {
+	unsigned n;
+	if (!read_unsigned(in, n)) break;
+	vector<RecordField> record(n);
+	unsigned long line_no;
+	for (auto&& field : record) {
+	    if (!read_string(in, field.name) ||
+		!read_string(in, field.value) ||
+		!read_unsigned(in, line_no)) {
+		_exit(1);
+	    }
+	    field.line_no = line_no;
+	}
+	if (!read_unsigned(in, line_no)) break;
+
+	IndexedRecord result;
+	index_record(record, fname.c_str(), line_no, indexer, result);
+
+	putc(result.skip ? 'S' : (result.seen_content ? 'A' : 'D'),
+	     worker_out);
+	write_string(worker_out, worker_messages.str());
+	worker_messages.str(string());
+	write_unsigned(worker_out, unsigned(result.unique_terms.size()));
+	for (auto&& term : result.unique_terms) {
+	    write_string(worker_out, term);
+	}
+	if (!result.skip && result.seen_content) {
+	    write_string(worker_out, result.doc.serialise());
+	}
+	write_unsigned(worker_out, spellings.termlist_count());
+	for (auto t = spellings.termlist_begin();
+	     t != spellings.termlist_end();
+	     ++t) {
+	    write_string(worker_out, *t);
+	    write_unsigned(worker_out, t.get_wdf());
+	}
+	spellings.clear_terms();
+	if (fflush(worker_out) != 0) break;
+    }
+
+    // Don't run any destructors - in particular the database must only be
+    // touched by the parent process.
+    _exit(0);
+}
+
+static void
+start_workers(unsigned n, Xapian::TermGenerator& indexer)
+{
+    // A worker dying shouldn't silently kill us when we write to it.
+    signal(SIGPIPE, SIG_IGN);
+
+    // Ensure the workers don't start with anything left in our buffer.
+    cout.flush();
+
+    for (unsigned i = 0; i != n; ++i) {
+	int to_worker[2], from_worker[2];
+	if (pipe(to_worker) < 0 || pipe(from_worker) < 0) {
+	    cerr << "Couldn't create pipe: " << strerror(errno) << '\n';
+	    exit(1);
+	}
+	pid_t child = fork();
+	if (child < 0) {
+	    cerr << "Couldn't fork worker process: " << strerror(errno) << '\n';
+	    exit(1);
+	}
+	if (child == 0) {
+	    // We're the child process.  Close our copies of the pipes to the
+	    // other workers so they see EOF when the parent closes them.
+	    for (auto&& worker : workers) {
+		close(fileno(worker.to_worker));
+		close(fileno(worker.from_worker));
+	    }
+	    close(to_worker[1]);
+	    close(from_worker[0]);
+	    worker_out = fdopen(from_worker[1], "w");
+	    run_worker(fdopen(to_worker[0], "r"), indexer);
+	}
+	close(to_worker[0]);
+	close(from_worker[1]);
+	workers.push_back({child,
+			   fdopen(to_worker[1], "w"),
+			   fdopen(from_worker[0], "r")});
+    }
+}
+
+[[noreturn]]
+static void
+worker_failed()
+{
+    cerr << "Worker process failed\n";
+    exit(1);
+}
+
+static void
+collect_record(Xapian::WritableDatabase& database)
+{
+    FILE* f = busy_workers.front()->from_worker;
+    busy_workers.pop_front();
+
+    int ch = getc(f);
+    string messages;
+    if (ch == EOF || !read_string(f, messages)) worker_failed();
+    cerr << messages;
+    if (ch == 'X') {
+	// The worker reported an error and exited.
+	exit(1);
+    }
+
+    IndexedRecord record;
+    record.skip = (ch == 'S');
+    record.seen_content = (ch == 'A');
+    unsigned n;
+    if (!read_unsigned(f, n)) worker_failed();
+    record.unique_terms.resize(n);
+    for (auto&& term : record.unique_terms) {
+	if (!read_string(f, term)) worker_failed();
+    }
+    if (record.seen_content) {
+	string serialised;
+	if (!read_string(f, serialised)) worker_failed();
+	record.doc = Xapian::Document::unserialise(serialised);
+    }
+    // Spellings are added even if the record ends up being skipped, as they
+    // are when the actions are run in this process.
+    if (!read_unsigned(f, n)) worker_failed();
+    while (n--) {
+	string word;
+	unsigned freq;
+	if (!read_string(f, word) || !read_unsigned(f, freq)) worker_failed();
+	database.add_spelling(word, freq);
+    }
+
+    add_record(database, record);
+}
+
+static void
+collect_all_records(Xapian::WritableDatabase& database)
+{
+    while (!busy_workers.empty())
+	collect_record(database);
+}
+
+static void
+send_record(Xapian::WritableDatabase& database, const char* fname,
+	    const vector<RecordField>& record, size_t line_no)
+{
+    if (busy_workers.size() == workers.size()) {
+	// Records are handed out in turn, so the oldest one in progress is
+	// on the worker we'll use next.
+	collect_record(database);
+    }
+
+    Worker& worker = workers[next_worker];
+    next_worker = (next_worker + 1) % workers.size();
+
+    FILE* f = worker.to_worker;
+    bool ok = write_string(f, fname, strlen(fname)) &&
+	      write_unsigned(f, unsigned(record.size()));
+    for (auto&& field : record) {
+	ok = ok &&
+	     write_string(f, field.name) &&
+	     write_string(f, field.value) &&
+	     write_unsigned(f, static_cast<unsigned long>(field.line_no));
+    }
+    ok = ok &&
+	 write_unsigned(f, static_cast<unsigned long>(line_no)) &&
+	 fflush(f) == 0;
+    if (!ok) worker_failed();
+    busy_workers.push_back(&worker);
+}
+
+static void
+stop_workers()
+{
+    for (auto&& worker : workers) {
+	fclose(worker.to_worker);
+	fclose(worker.from_worker);
+	waitpid(worker.pid, NULL, 0);
+    }
+    workers.clear();
+}
+#endif
+
 static void
 index_file(const char *fname, istream &stream,
 	   Xapian::WritableDatabase &database, Xapian::TermGenerator &indexer)
@@ -1453,16 +1871,30 @@ index_file(const char *fname, istream &stream,
 	// between records.
 	if (line.empty()) continue;
 
-	Xapian::Document doc;
-	indexer.set_document(doc);
-	Xapian::docid docid = 0;
-	map<string, list<string>> fields;
-	bool seen_content = false;
-	skipping_record = false;
-	unique_unused = index_spec_uses_unique;
+	// Without worker processes, run the actions for each field as it's
+	// read so that diagnostics come out in the order of the input.
+	bool serial = true;
+#ifdef HAVE_FORK
+	serial = workers.empty();
+#endif
+	IndexedRecord result;
+	if (serial) start_record(indexer, result);
+
+	vector<RecordField> record;
 	while (!line.empty()) {
 	    string::size_type eq = line.find('=');
 	    if (eq == string::npos && !line.empty()) {
+#ifdef HAVE_FORK
+		if (!serial) {
+		    // Report problems with earlier records and the fields of
+		    // this record first, as we would without worker processes.
+		    collect_all_records(database);
+		    start_record(indexer, result);
+		    for (auto&& f : record) {
+			index_field(f, fname, indexer, result);
+		    }
+		}
+#endif
 		report_location(DIAG_ERROR, fname, line_no);
 		cerr << "Expected = somewhere in this line\n";
 		exit(1);
@@ -1478,85 +1910,25 @@ index_file(const char *fname, istream &stream,
 		value += line;
 		line.erase();
 	    }
-
-	    if (skipping_record) continue;
-
-	    // Default to not indexing spellings.
-	    indexer.set_flags(Xapian::TermGenerator::flags(0));
-
-	    bool this_field_is_content = true;
-	    const vector<Action>& v = index_spec[field];
-	    run_actions(v.begin(), v.end(),
-			database, indexer, value,
-			this_field_is_content, doc, fields,
-			field, fname, line_no,
-			docid);
-	    if (this_field_is_content) seen_content = true;
+	    record.push_back({std::move(field), std::move(value), line_no});
+	    if (serial) index_field(record.back(), fname, indexer, result);
 	}
 
-	if (unique_unused) {
-	    enum diag_type diag = DIAG_WARN;
-	    switch (unique_missing) {
-	      case UNIQUE_ERROR:
-		diag = DIAG_ERROR;
-		/* FALLTHRU */
-	      case UNIQUE_WARN_NEW:
-	      case UNIQUE_WARN_SKIP:
-		report_location(diag, fname, line_no);
-		cerr << "UNIQUE action unused in this record\n";
-	      default:
-		break;
-	    }
-	    switch (unique_missing) {
-	      case UNIQUE_ERROR:
-		exit(1);
-	      case UNIQUE_SKIP:
-	      case UNIQUE_WARN_SKIP:
-		skipping_record = true;
-		break;
-	      case UNIQUE_NEW:
-	      case UNIQUE_WARN_NEW:
-		break;
-	    }
+#ifdef HAVE_FORK
+	if (!serial) {
+	    send_record(database, fname, record, line_no);
+	    continue;
 	}
+#endif
 
-	if (skipping_record) {
-	    ++skipcount;
-	} else if (!seen_content) {
-	    // We haven't seen any fields (other than unique identifiers)
-	    // so the document is to be deleted.
-	    if (docid) {
-		database.delete_document(docid);
-		if (verbose) cout << "Del: " << docid << '\n';
-		++delcount;
-	    }
-	} else {
-	    string data;
-	    for (auto&& i : fields) {
-		for (auto&& field_val : i.second) {
-		    data += i.first;
-		    data += '=';
-		    data += field_val;
-		    data += '\n';
-		}
-	    }
-
-	    // Put the data in the document
-	    doc.set_data(data);
-
-	    // Add the document to the database
-	    if (docid) {
-		database.replace_document(docid, doc);
-		if (verbose) cout << "Replace: " << docid << '\n';
-		++repcount;
-	    } else {
-		docid = database.add_document(doc);
-		if (verbose) cout << "Add: " << docid << '\n';
-		++addcount;
-	    }
-	}
+	finish_record(fname, line_no, result);
+	add_record(database, result);
     }
 
+#ifdef HAVE_FORK
+    collect_all_records(database);
+#endif
+
     // Commit after each file to make sure all changes from that file make it
     // in.
     if (verbose) cout << "Committing\n";
@@ -1578,6 +1950,8 @@ show_help(int exit_code)
 "\n"
 "Options:\n"
 "  -v, --verbose       display additional messages to aid debugging\n"
+"  -j, --jobs=N        run the index script on up to N records at once, each\n"
+"                      in its own subprocess (default: 1)\n"
 "      --overwrite     create the database anew (the default is to update if\n"
 "                      the database already exists)\n";
     print_stemmer_help("");
@@ -1592,6 +1966,7 @@ try {
     int database_mode = Xapian::DB_CREATE_OR_OPEN;
     verbose = false;
     Xapian::Stem stemmer("english");
+    unsigned jobs = 1;
 
     // Without this, strptime() seems to treat formats without a timezone as
     // being local time, including %s.
@@ -1605,11 +1980,12 @@ try {
 	{ "stemmer",	REQ_ARG,	NULL, 's' },
 	{ "overwrite",	NO_ARG,		NULL, 'o' },
 	{ "verbose",	NO_ARG,		NULL, 'v' },
+	{ "jobs",	REQ_ARG,	NULL, 'j' },
 	{ 0, 0, NULL, 0 }
     };
 
     int getopt_ret;
-    while ((getopt_ret = gnu_getopt_long(argc, argv, "vs:hV",
+    while ((getopt_ret = gnu_getopt_long(argc, argv, "vs:hVj:",
 					 longopts, NULL)) != -1) {
 	switch (getopt_ret) {
 	    default:
@@ -1637,6 +2013,12 @@ try {
 		    return 1;
 		}
 		break;
+	    case 'j':
+		if (!parse_unsigned(optarg, jobs) || jobs == 0) {
+		    cerr << "Bad --jobs argument: '" << optarg << "'\n";
+		    return 1;
+		}
+		break;
 	}
     }
 
@@ -1655,6 +2037,9 @@ try {
 
     Xapian::TermGenerator indexer;
     indexer.set_stemmer(stemmer);
+    // Records in a dump tend to share much of their vocabulary.  With --jobs
+    // each worker process ends up with its own copy of this cache.
+    indexer.set_stemmer_cache_size(16384);
     // Set the database for spellings to be added to by the "spell" action.
     indexer.set_database(database);
 
@@ -1663,6 +2048,12 @@ try {
     delcount = 0;
     skipcount = 0;
 
+#ifdef HAVE_FORK
+    // Records are still added to the database in input order by this
+    // process, so there's no point using a single worker.
+    if (jobs > 1) start_workers(jobs, indexer);
+#endif
+
     if (argc == 2) {
 	// Read from stdin.
 	index_file("<stdin>", cin, database, indexer);
@@ -1678,6 +2069,10 @@ try {
 	}
     }
 
+#ifdef HAVE_FORK
+    stop_workers();
+#endif
+
     cout << "records (added, replaced, deleted, skipped) = ("
 	 << addcount << ", "
 	 << repcount << ", "
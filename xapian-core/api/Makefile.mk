@@ -1,8 +1,10 @@
 noinst_HEADERS +=\
+	api/cancelflaginternal.h\
 	api/documenttermlist.h\
 	api/documentvaluelist.h\
 	api/editdistance.h\
 	api/enquireinternal.h\
+	api/msetcacheinternal.h\
 	api/msetinternal.h\
 	api/result.h\
 	api/postingiteratorinternal.h\
@@ -20,6 +22,7 @@ EXTRA_DIST +=\
 	api/Makefile
 
 lib_src +=\
+	api/cancelflag.cc\
 	api/compactor.cc\
 	api/constinfo.cc\
 	api/database.cc\
@@ -34,6 +37,7 @@ lib_src +=\
 	api/keymaker.cc\
 	api/matchspy.cc\
 	api/mset.cc\
+	api/msetcache.cc\
 	api/msetiterator.cc\
 	api/result.cc\
 	api/positioniterator.cc\
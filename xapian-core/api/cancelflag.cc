@@ -0,0 +1,69 @@
+/** @file
+ * @brief Flag which can be used to stop a running search
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "xapian/cancelflag.h"
+#include "cancelflaginternal.h"
+
+#include <string>
+
+using namespace std;
+
+namespace Xapian {
+
+CancelFlag::CancelFlag(const CancelFlag&) = default;
+
+CancelFlag&
+CancelFlag::operator=(const CancelFlag&) = default;
+
+CancelFlag::CancelFlag(CancelFlag&&) = default;
+
+CancelFlag&
+CancelFlag::operator=(CancelFlag&&) = default;
+
+CancelFlag::CancelFlag() : internal(new CancelFlag::Internal) {}
+
+CancelFlag::~CancelFlag() {}
+
+void
+CancelFlag::cancel()
+{
+    internal->cancelled.store(true, memory_order_relaxed);
+}
+
+bool
+CancelFlag::is_cancelled() const
+{
+    return internal->cancelled.load(memory_order_relaxed);
+}
+
+void
+CancelFlag::reset()
+{
+    internal->cancelled.store(false, memory_order_relaxed);
+}
+
+string
+CancelFlag::get_description() const
+{
+    return is_cancelled() ? "CancelFlag(cancelled)" : "CancelFlag()";
+}
+
+}
@@ -0,0 +1,44 @@
+/** @file
+ * @brief Internals of Xapian::CancelFlag
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_CANCELFLAGINTERNAL_H
+#define XAPIAN_INCLUDED_CANCELFLAGINTERNAL_H
+
+#include "xapian/cancelflag.h"
+#include "xapian/intrusive_ptr.h"
+
+#include <atomic>
+
+namespace Xapian {
+
+class CancelFlag::Internal : public Xapian::Internal::intrusive_base {
+  public:
+    /** Set by CancelFlag::cancel().
+     *
+     *  This may be set from another thread or from a signal handler while a
+     *  search is running, so we use an atomic.  The match only polls it, so
+     *  relaxed memory ordering is sufficient.
+     */
+    std::atomic<bool> cancelled{false};
+};
+
+}
+
+#endif // XAPIAN_INCLUDED_CANCELFLAGINTERNAL_H
@@ -26,16 +26,21 @@
 #include "expand/esetinternal.h"
 #include "expand/expandweight.h"
 #include "matcher/matcher.h"
+#include "msetcacheinternal.h"
 #include "msetinternal.h"
 #include "omassert.h"
+#include "pack.h"
+#include "serialise-double.h"
 #include "vectortermlist.h"
 #include "weight/weightinternal.h"
+#include "xapian/cancelflag.h"
 #include "xapian/database.h"
 #include "xapian/error.h"
 #include "xapian/expanddecider.h"
 #include "xapian/intrusive_ptr.h"
 #include "xapian/keymaker.h"
 #include "xapian/matchspy.h"
+#include "xapian/msetcache.h"
 #include "xapian/query.h"
 #include "xapian/rset.h"
 #include "xapian/weight.h"
@@ -196,6 +201,36 @@ Enquire::set_time_limit(double time_limit)
     internal->time_limit = time_limit;
 }
 
+void
+Enquire::set_mset_cache(const MSetCache& cache)
+{
+    internal->mset_cache.reset(new MSetCache(cache));
+}
+
+void
+Enquire::clear_mset_cache()
+{
+    internal->mset_cache.reset();
+}
+
+void
+Enquire::set_cancel_flag(const CancelFlag& flag)
+{
+    internal->cancel_flag = flag.internal.get();
+}
+
+void
+Enquire::clear_cancel_flag()
+{
+    internal->cancel_flag = NULL;
+}
+
+void
+Enquire::set_remote_deadline(double deadline)
+{
+    internal->remote_deadline = deadline;
+}
+
 MSet
 Enquire::get_mset(doccount first,
 		  doccount maxitems,
@@ -289,6 +324,91 @@ Enquire::Internal::get_mset(doccount first,
 	checkatleast = max(checkatleast, first + maxitems);
     }
 
+    MSet mset;
+    string key;
+    // If checkatleast is 0 we only need to estimate the number of matches,
+    // which is cheap.
+    if (mset_cache && checkatleast && get_cache_key(key, rset, mdecider)) {
+	MSetCache::Internal& cache = *mset_cache->internal;
+	Xapian::doccount end = first + maxitems;
+	Xapian::Internal::intrusive_ptr<const MSet::Internal> cached;
+	cached = cache.find(key, end, checkatleast);
+	if (!cached) {
+	    // Run the search from the first result so that requests for
+	    // earlier pages can be answered from the cache too.  The cost of
+	    // this is small as the matcher has to find those results anyway.
+	    Xapian::doccount cache_check = checkatleast;
+	    cache.widen(key, end, cache_check);
+	    cache_check = max(cache_check, end);
+	    cached = run_match(0, end, cache_check, rset, mdecider).internal.get();
+	    cache.add(key, cached.get(), end, cache_check);
+	}
+	mset = MSet(cached->copy_range(first, maxitems));
+    } else {
+	mset = run_match(first, maxitems, checkatleast, rset, mdecider);
+    }
+
+    // Set this even if first wasn't clamped above, as the MSet returned when
+    // remote shards miss the deadline may not have it set.
+    mset.internal->set_first(first_orig);
+
+    mset.internal->set_enquire(this);
+
+    return mset;
+}
+
+bool
+Enquire::Internal::get_cache_key(string& key,
+				 const RSet* rset,
+				 const MatchDecider* mdecider) const
+{
+    if ((rset && !rset->empty()) || mdecider || !matchspies.empty() ||
+	time_limit > 0.0 || cancel_flag.get() || remote_deadline > 0.0) {
+	return false;
+    }
+
+    if (!db.internal->append_revision_key(key))
+	return false;
+
+    string weight_name = weight->name();
+    if (weight_name.empty())
+	return false;
+
+    try {
+	pack_string(key, query.serialise());
+	pack_uint(key, query_length);
+	pack_string(key, weight_name);
+	pack_string(key, weight->serialise());
+	pack_uint(key, unsigned(sort_by));
+	if (sort_by != REL) {
+	    if (sort_functor.get()) {
+		pack_string(key, sort_functor->name());
+		pack_string(key, sort_functor->serialise());
+	    } else {
+		pack_string_empty(key);
+		pack_uint(key, sort_key);
+	    }
+	    pack_bool(key, sort_val_reverse);
+	}
+	pack_uint(key, unsigned(order));
+	pack_uint(key, collapse_key);
+	pack_uint(key, collapse_max);
+	pack_uint(key, unsigned(percent_threshold));
+	key += serialise_double(weight_threshold);
+    } catch (const Xapian::UnimplementedError&) {
+	// The Query, Weight or KeyMaker can't be serialised.
+	return false;
+    }
+    return true;
+}
+
+MSet
+Enquire::Internal::run_match(doccount first,
+			     doccount maxitems,
+			     doccount checkatleast,
+			     const RSet* rset,
+			     const MatchDecider* mdecider) const
+{
     unique_ptr<Xapian::Weight::Internal> stats(new Xapian::Weight::Internal);
     ::Matcher match(db,
 		    query,
@@ -306,6 +426,7 @@ Enquire::Internal::get_mset(doccount first,
 		    sort_by,
 		    sort_val_reverse,
 		    time_limit,
+		    remote_deadline,
 		    matchspies);
 
     MSet mset = match.get_mset(first,
@@ -324,18 +445,16 @@ Enquire::Internal::get_mset(doccount first,
 			       sort_by,
 			       sort_val_reverse,
 			       time_limit,
+			       cancel_flag.get() ? &cancel_flag->cancelled : NULL,
+			       -1,
 			       matchspies);
 
-    if (first_orig != first) {
-	mset.internal->set_first(first_orig);
-    }
-
-    mset.internal->set_enquire(this);
-
     if (!mset.internal->get_stats()) {
 	mset.internal->set_stats(stats.release());
     }
 
+    match.report_missing_shards(mset);
+
     return mset;
 }
 
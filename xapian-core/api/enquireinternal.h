@@ -21,6 +21,7 @@
 #ifndef XAPIAN_INCLUDED_ENQUIREINTERNAL_H
 #define XAPIAN_INCLUDED_ENQUIREINTERNAL_H
 
+#include "api/cancelflaginternal.h"
 #include "backends/databaseinternal.h"
 #include "xapian/constants.h"
 #include "xapian/database.h"
@@ -29,6 +30,7 @@
 #include "xapian/keymaker.h"
 #include "xapian/matchspy.h"
 #include "xapian/mset.h" // Only needed to forward declare MSet::Internal.
+#include "xapian/msetcache.h"
 #include "xapian/query.h"
 
 #include <memory>
@@ -79,10 +81,35 @@ class Enquire::Internal : public Xapian::Internal::intrusive_base {
 
     double time_limit = 0.0;
 
+    std::unique_ptr<Xapian::MSetCache> mset_cache;
+
+    Xapian::Internal::intrusive_ptr<CancelFlag::Internal> cancel_flag;
+
+    double remote_deadline = 0.0;
+
     enum { EXPAND_TRAD, EXPAND_BO1 } eweight = EXPAND_TRAD;
 
     double expand_k = 1.0;
 
+    /** Build the key to cache the current search under.
+     *
+     *  @return false if the search can't be cached.
+     */
+    bool get_cache_key(std::string& key,
+		       const RSet* rset,
+		       const MatchDecider* mdecider) const;
+
+    /** Run the match.
+     *
+     *  The parameters must already have been clamped to the database size.
+     *  The Enquire pointer isn't set in the returned MSet.
+     */
+    MSet run_match(doccount first,
+		   doccount maxitems,
+		   doccount checkatleast,
+		   const RSet* rset,
+		   const MatchDecider* mdecider) const;
+
   public:
     explicit
     Internal(const Database& db_);
@@ -34,7 +34,9 @@
 
 #include <algorithm>
 #include <cfloat>
+#include <memory>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -174,6 +176,25 @@ MSet::get_max_possible() const
     return internal->max_possible;
 }
 
+bool
+MSet::was_cancelled() const
+{
+    return internal->cancelled;
+}
+
+Xapian::doccount
+MSet::get_missing_shard_count() const
+{
+    return internal->missing_shards.size();
+}
+
+bool
+MSet::was_shard_missing(Xapian::doccount shard) const
+{
+    const auto& missing = internal->missing_shards;
+    return binary_search(missing.begin(), missing.end(), shard);
+}
+
 Xapian::doccount
 MSet::size() const
 {
@@ -311,12 +332,63 @@ MSet::Internal::merge_stats(const Internal* o, bool collapsing)
     uncollapsed_estimated += o->uncollapsed_estimated;
     uncollapsed_upper_bound += o->uncollapsed_upper_bound;
     max_possible = max(max_possible, o->max_possible);
+    if (o->cancelled) cancelled = true;
     if (o->max_attained > max_attained) {
 	max_attained = o->max_attained;
 	percent_scale_factor = o->percent_scale_factor;
     }
 }
 
+MSet::Internal*
+MSet::Internal::copy_range(Xapian::doccount offset,
+			   Xapian::doccount maxitems) const
+{
+    vector<Result> new_items;
+    if (offset < items.size()) {
+	auto n = min(items.size() - offset, size_t(maxitems));
+	new_items.reserve(n);
+	for (auto i = items.begin() + offset; n; ++i, --n) {
+	    new_items.emplace_back(i->get_weight(), i->get_docid(),
+				   string(i->get_collapse_key()),
+				   i->get_collapse_count(),
+				   string(i->get_sort_key()));
+	}
+    }
+    unique_ptr<Internal> r(new Internal(first + offset,
+					matches_upper_bound,
+					matches_lower_bound,
+					matches_estimated,
+					uncollapsed_upper_bound,
+					uncollapsed_lower_bound,
+					uncollapsed_estimated,
+					max_possible,
+					max_attained,
+					std::move(new_items),
+					percent_scale_factor));
+    r->snippet_bg_relevance = snippet_bg_relevance;
+    r->cancelled = cancelled;
+    r->missing_shards = missing_shards;
+    if (stats) r->stats.reset(new Xapian::Weight::Internal(*stats));
+    return r.release();
+}
+
+size_t
+MSet::Internal::get_memory_used() const
+{
+    size_t result = sizeof(*this) + items.capacity() * sizeof(Result);
+    for (auto&& item : items) {
+	result += item.get_collapse_key().size() + item.get_sort_key().size();
+    }
+    if (stats) {
+	result += sizeof(*stats);
+	for (auto&& i : stats->termfreqs) {
+	    // Allow for the map node overheads too.
+	    result += sizeof(i) + i.first.size() + 4 * sizeof(void*);
+	}
+    }
+    return result;
+}
+
 string
 MSet::Internal::serialise() const
 {
@@ -340,6 +412,7 @@ MSet::Internal::serialise() const
     pack_uint(result, uncollapsed_lower_bound);
     pack_uint(result, uncollapsed_estimated);
     pack_uint(result, uncollapsed_upper_bound);
+    pack_bool(result, cancelled);
 
     pack_uint(result, items.size());
     for (auto&& item : items) {
@@ -374,6 +447,7 @@ MSet::Internal::unserialise(const char * p, const char * p_end)
 	!unpack_uint(&p, p_end, &uncollapsed_lower_bound) ||
 	!unpack_uint(&p, p_end, &uncollapsed_estimated) ||
 	!unpack_uint(&p, p_end, &uncollapsed_upper_bound) ||
+	!unpack_bool(&p, p_end, &cancelled) ||
 	!unpack_uint(&p, p_end, &msize)) {
 	unpack_throw_serialisation_error(p);
     }
@@ -431,6 +505,13 @@ MSet::Internal::get_description() const
 	desc += ", max_attained=";
 	desc += str(max_attained);
     }
+    if (cancelled) {
+	desc += ", cancelled";
+    }
+    if (!missing_shards.empty()) {
+	desc += ", missing_shards=";
+	desc += str(missing_shards.size());
+    }
     desc += ", [";
     bool comma = false;
     for (auto&& item : items) {
@@ -0,0 +1,180 @@
+/** @file
+ * @brief Cache of search results which can be shared between Enquire objects
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "xapian/msetcache.h"
+#include "msetcacheinternal.h"
+
+#include "msetinternal.h"
+#include "omassert.h"
+#include "str.h"
+
+#include <algorithm>
+#include <string>
+
+using namespace std;
+
+namespace Xapian {
+
+MSetCache::MSetCache(const MSetCache&) = default;
+
+MSetCache&
+MSetCache::operator=(const MSetCache&) = default;
+
+MSetCache::MSetCache(MSetCache&&) = default;
+
+MSetCache&
+MSetCache::operator=(MSetCache&&) = default;
+
+MSetCache::MSetCache(size_t max_size)
+    : internal(new MSetCache::Internal(max_size)) {}
+
+MSetCache::~MSetCache() {}
+
+size_t
+MSetCache::get_size() const
+{
+    return internal->size;
+}
+
+size_t
+MSetCache::get_max_size() const
+{
+    return internal->max_size;
+}
+
+size_t
+MSetCache::get_entry_count() const
+{
+    return internal->entries.size();
+}
+
+unsigned long
+MSetCache::get_hits() const
+{
+    return internal->hits;
+}
+
+unsigned long
+MSetCache::get_misses() const
+{
+    return internal->misses;
+}
+
+void
+MSetCache::clear()
+{
+    internal->entries.clear();
+    internal->lru.clear();
+    internal->size = 0;
+}
+
+string
+MSetCache::get_description() const
+{
+    string desc = "MSetCache(";
+    desc += str(internal->entries.size());
+    desc += " entries, size=";
+    desc += str(internal->size);
+    desc += ", max_size=";
+    desc += str(internal->max_size);
+    desc += ", hits=";
+    desc += str(internal->hits);
+    desc += ", misses=";
+    desc += str(internal->misses);
+    desc += ')';
+    return desc;
+}
+
+void
+MSetCache::Internal::erase(unordered_map<string, Entry>::iterator it)
+{
+    size -= it->second.size;
+    lru.erase(it->second.lru_pos);
+    entries.erase(it);
+}
+
+const MSet::Internal*
+MSetCache::Internal::find(const string& key,
+			  Xapian::doccount end,
+			  Xapian::doccount checkatleast)
+{
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+	const Entry& entry = it->second;
+	// If the search found fewer results than it asked for then there
+	// aren't any more to find.
+	if ((entry.maxitems >= end || entry.mset->size() < entry.maxitems) &&
+	    entry.checkatleast >= checkatleast) {
+	    ++hits;
+	    // Move to the front of the LRU list.
+	    lru.splice(lru.begin(), lru, entry.lru_pos);
+	    return entry.mset.get();
+	}
+    }
+    ++misses;
+    return NULL;
+}
+
+void
+MSetCache::Internal::widen(const string& key,
+			   Xapian::doccount& end,
+			   Xapian::doccount& checkatleast) const
+{
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+	end = max(end, it->second.maxitems);
+	checkatleast = max(checkatleast, it->second.checkatleast);
+    }
+}
+
+void
+MSetCache::Internal::add(const string& key,
+			 const MSet::Internal* mset,
+			 Xapian::doccount maxitems,
+			 Xapian::doccount checkatleast)
+{
+    AssertEq(mset->get_first(), 0);
+    auto it = entries.find(key);
+    if (it != entries.end()) erase(it);
+
+    // Allow for the key and the per-node overheads of entries and lru.
+    size_t entry_size = mset->get_memory_used() + key.size() +
+			sizeof(string) + sizeof(Entry) +
+			sizeof(const string*) * 4;
+    if (entry_size > max_size) return;
+
+    while (size + entry_size > max_size) {
+	Assert(!lru.empty());
+	erase(entries.find(*lru.back()));
+    }
+
+    auto r = entries.emplace(key, Entry());
+    Entry& entry = r.first->second;
+    entry.mset = mset;
+    entry.maxitems = maxitems;
+    entry.checkatleast = checkatleast;
+    entry.size = entry_size;
+    lru.push_front(&r.first->first);
+    entry.lru_pos = lru.begin();
+    size += entry_size;
+}
+
+}
@@ -0,0 +1,117 @@
+/** @file
+ * @brief Xapian::MSetCache internals
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_MSETCACHEINTERNAL_H
+#define XAPIAN_INCLUDED_MSETCACHEINTERNAL_H
+
+#include "xapian/intrusive_ptr.h"
+#include "xapian/msetcache.h"
+#include "xapian/mset.h"
+#include "xapian/types.h"
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+namespace Xapian {
+
+class MSetCache::Internal : public Xapian::Internal::intrusive_base {
+    friend class MSetCache;
+
+    /// A cached search.
+    struct Entry {
+	/** The results, starting from the first.
+	 *
+	 *  The Enquire pointer isn't set in this object.
+	 */
+	Xapian::Internal::intrusive_ptr<const MSet::Internal> mset;
+
+	/// The number of results which were asked for.
+	Xapian::doccount maxitems;
+
+	/// The checkatleast value used for the search.
+	Xapian::doccount checkatleast;
+
+	/// Approximate memory used by this entry.
+	size_t size;
+
+	/// Position of this entry's key in lru.
+	std::list<const std::string*>::iterator lru_pos;
+    };
+
+    /// Cached searches, keyed by a serialisation of their parameters.
+    std::unordered_map<std::string, Entry> entries;
+
+    /// Keys of entries, most recently used first.
+    std::list<const std::string*> lru;
+
+    size_t size = 0;
+
+    size_t max_size;
+
+    unsigned long hits = 0;
+
+    unsigned long misses = 0;
+
+    void erase(std::unordered_map<std::string, Entry>::iterator it);
+
+  public:
+    explicit Internal(size_t max_size_) : max_size(max_size_) {}
+
+    /** Look for a cached search which can answer a request.
+     *
+     *  A cached search can answer a request for the first @a end results
+     *  if it asked for at least that many results (or found fewer than it
+     *  asked for), and checked at least @a checkatleast documents.
+     *
+     *  Updates the hit and miss counts.
+     *
+     *  @return The cached results, starting from the first, or NULL if there
+     *		aren't suitable cached results.
+     */
+    const MSet::Internal* find(const std::string& key,
+			       Xapian::doccount end,
+			       Xapian::doccount checkatleast);
+
+    /** Get the parameters to use to run a search which missed.
+     *
+     *  If there's a cached entry for @a key which couldn't answer the request,
+     *  @a end and @a checkatleast are increased (if necessary) so that the new
+     *  search can also answer any request the old one could.
+     */
+    void widen(const std::string& key,
+	       Xapian::doccount& end,
+	       Xapian::doccount& checkatleast) const;
+
+    /** Add a search to the cache.
+     *
+     *  Replaces any existing entry for @a key.
+     *
+     *  @param mset	The results, which must start from the first and not
+     *		have an Enquire pointer set.
+     */
+    void add(const std::string& key,
+	     const MSet::Internal* mset,
+	     Xapian::doccount maxitems,
+	     Xapian::doccount checkatleast);
+};
+
+}
+
+#endif // XAPIAN_INCLUDED_MSETCACHEINTERNAL_H
@@ -83,6 +83,12 @@ class MSet::Internal : public Xapian::Internal::intrusive_base {
     /// Scale factor to convert weights to percentages.
     double percent_scale_factor = 0;
 
+    /// Was the match stopped early by a cancellation request?
+    bool cancelled = false;
+
+    /// Shards left out of the match because they didn't reply in time.
+    std::vector<Xapian::doccount> missing_shards;
+
   public:
     Internal() {}
 
@@ -111,6 +117,12 @@ class MSet::Internal : public Xapian::Internal::intrusive_base {
 
     void set_first(Xapian::doccount first_) { first = first_; }
 
+    void set_cancelled() { cancelled = true; }
+
+    Xapian::doccount get_first() const { return first; }
+
+    Xapian::doccount size() const { return items.size(); }
+
     void set_enquire(const Xapian::Enquire::Internal* enquire_) {
 	enquire = enquire_;
     }
@@ -133,6 +145,21 @@ class MSet::Internal : public Xapian::Internal::intrusive_base {
 
     void merge_stats(const Internal* o, bool collapsing);
 
+    /** Copy a range of the results.
+     *
+     *  The copy has all the statistics of this object, but no Enquire
+     *  pointer.
+     *
+     *  @param offset	Index of the first result to copy, relative to the
+     *			start of this object.
+     *  @param maxitems	The maximum number of results to copy.
+     */
+    Internal* copy_range(Xapian::doccount offset,
+			 Xapian::doccount maxitems) const;
+
+    /// Return an estimate of the memory used by this object.
+    size_t get_memory_used() const;
+
     std::string snippet(const std::string & text, size_t length,
 			const Xapian::Stem & stemmer,
 			unsigned flags,
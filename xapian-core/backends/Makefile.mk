@@ -15,6 +15,7 @@ noinst_HEADERS +=\
 	backends/postlist.h\
 	backends/prefix_compressed_strings.h\
 	backends/slowvaluelist.h\
+	backends/termstatscache.h\
 	backends/uuids.h\
 	backends/valuelist.h\
 	backends/valuestats.h
@@ -402,6 +402,12 @@ Database::Internal::get_uuid() const
     return string();
 }
 
+bool
+Database::Internal::append_revision_key(string&) const
+{
+    return false;
+}
+
 void
 Database::Internal::invalidate_doc_object(Xapian::Document::Internal*) const
 {
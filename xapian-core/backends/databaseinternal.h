@@ -449,6 +449,18 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
      */
     virtual std::string get_uuid() const;
 
+    /** Append a key identifying the contents of this database to @a key.
+     *
+     *  The key must identify the database and the revision this object is
+     *  reading, so that it changes whenever the results of a search could,
+     *  and it must be able to be concatenated with other such keys
+     *  unambiguously.  It's used to key cached search results.
+     *
+     *  @return true if a key was appended; false if this isn't possible (the
+     *		default), in which case @a key may have been modified.
+     */
+    virtual bool append_revision_key(std::string& key) const;
+
     /** Notify the database that document is no longer valid.
      *
      *  This is used to invalidate references to a document kept by a
@@ -30,10 +30,12 @@
 #include "backends/databaseinternal.h"
 #include "overflow.h"
 
+#include <iterator>
 #include <limits>
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 
 class DocumentTermList;
 class DocumentValueList;
@@ -292,6 +294,76 @@ class Document::Internal : public Xapian::Internal::intrusive_base {
 	    ++termlist_size;
     }
 
+    /// Iterator over the term map, used as a hint by add_postings().
+    typedef std::map<std::string, TermInfo>::iterator term_hint;
+
+    /** Prepare to call add_postings().
+     *
+     *  @return	The hint to pass to the first call to add_postings().
+     */
+    term_hint start_add_postings() {
+	ensure_terms_fetched();
+	return terms->begin();
+    }
+
+    /** Add a term with postings at several positions.
+     *
+     *  This is equivalent to calling add_posting() for each position in
+     *  [pos, pos_end) and then add_term(term, extra_wdf) if @a extra_wdf is
+     *  non-zero, but is much more efficient when adding many terms in
+     *  ascending order, as each term is then added to the term map without
+     *  having to search it.
+     *
+     *  @param hint	Hint returned by start_add_postings() (or updated by a
+     *			previous call to this method).  It is updated to point
+     *			after @a term.
+     *  @param term	The term to add.
+     *  @param pos	Start of the positions, which must be in ascending
+     *			order.
+     *  @param pos_end	End of the positions.
+     *  @param wdf_inc	The wdf increment for each position.
+     *  @param extra_wdf	Additional wdf to add.
+     */
+    void add_postings(term_hint& hint,
+		      const std::string& term,
+		      const Xapian::termpos* pos,
+		      const Xapian::termpos* pos_end,
+		      Xapian::termcount wdf_inc,
+		      Xapian::termcount extra_wdf) {
+	if (pos != pos_end) positions_modified_ = true;
+
+	auto i = hint;
+	int cmp = (i == terms->end()) ? 1 : i->first.compare(term);
+	if (cmp < 0) {
+	    // Terms weren't added in ascending order, or there are existing
+	    // terms between the previous one and this.
+	    i = terms->lower_bound(term);
+	    cmp = (i == terms->end()) ? 1 : i->first.compare(term);
+	}
+
+	if (cmp > 0) {
+	    // A new term, which goes before i.
+	    ++termlist_size;
+	    Xapian::termcount wdf = extra_wdf;
+	    TermInfo info(0);
+	    while (pos != pos_end) {
+		info.append_position(*pos++);
+		wdf += wdf_inc;
+	    }
+	    info.increase_wdf(wdf);
+	    hint = std::next(terms->emplace_hint(i, term, std::move(info)));
+	    return;
+	}
+
+	while (pos != pos_end) {
+	    if (i->second.add_position(wdf_inc, *pos++))
+		++termlist_size;
+	}
+	if (extra_wdf && i->second.increase_wdf(extra_wdf))
+	    ++termlist_size;
+	hint = std::next(i);
+    }
+
     enum remove_posting_result { OK, NO_TERM, NO_POS };
 
     /// Remove a posting for a term.
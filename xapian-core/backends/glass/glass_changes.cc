@@ -248,6 +248,15 @@ GlassChanges::check(const string & changes_file)
 	uint4 block_number;
 	if (!unpack_uint(&p, end, &block_number))
 	    throw Xapian::DatabaseError("Changes file - bad block number");
+	unsigned gap_start, gap_len;
+	if (!unpack_uint(&p, end, &gap_start) ||
+	    !unpack_uint(&p, end, &gap_len) ||
+	    gap_start > block_size ||
+	    gap_len > block_size - gap_start) {
+	    throw Xapian::DatabaseError("Changes file - bad block gap");
+	}
+	// The gap isn't stored.
+	block_size -= gap_len;
 
 	// Parse information from the start of the block.
 	//
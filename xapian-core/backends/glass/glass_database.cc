@@ -259,6 +259,7 @@ GlassDatabase::open_tables(int flags)
     spelling_table.set_wordfreq_upper_bound(swfub);
 
     value_manager.reset();
+    term_stats_cache.clear();
 
     if (!readonly) {
 	changes.set_oldest_changeset(version_file.get_oldest_changeset());
@@ -341,6 +342,18 @@ GlassDatabase::set_revision_number(int flags, glass_revision_number_t new_revisi
 	throw Xapian::DatabaseError(m);
     }
 
+    // Readers of this many revisions before the latest one can carry on
+    // without getting DatabaseModifiedError, at the cost of the database
+    // growing a bit while freed blocks are held back.
+    unsigned keep_revisions = 0;
+    const char *p = getenv("XAPIAN_KEEP_REVISIONS");
+    if (p && *p) {
+	if (!parse_unsigned(p, keep_revisions)) {
+	    throw Xapian::InvalidArgumentError("XAPIAN_KEEP_REVISIONS must be "
+					       "a non-negative integer");
+	}
+    }
+
     value_manager.merge_changes();
 
     postlist_table.flush_db();
@@ -350,12 +363,24 @@ GlassDatabase::set_revision_number(int flags, glass_revision_number_t new_revisi
     version_file.set_spelling_wordfreq_upper_bound(spelling_table.flush_db());
     docdata_table.flush_db();
 
-    postlist_table.commit(new_revision, version_file.root_to_set(Glass::POSTLIST));
-    position_table.commit(new_revision, version_file.root_to_set(Glass::POSITION));
-    termlist_table.commit(new_revision, version_file.root_to_set(Glass::TERMLIST));
-    synonym_table.commit(new_revision, version_file.root_to_set(Glass::SYNONYM));
-    spelling_table.commit(new_revision, version_file.root_to_set(Glass::SPELLING));
-    docdata_table.commit(new_revision, version_file.root_to_set(Glass::DOCDATA));
+    postlist_table.commit(new_revision,
+			  version_file.root_to_set(Glass::POSTLIST),
+			  keep_revisions);
+    position_table.commit(new_revision,
+			  version_file.root_to_set(Glass::POSITION),
+			  keep_revisions);
+    termlist_table.commit(new_revision,
+			  version_file.root_to_set(Glass::TERMLIST),
+			  keep_revisions);
+    synonym_table.commit(new_revision,
+			 version_file.root_to_set(Glass::SYNONYM),
+			 keep_revisions);
+    spelling_table.commit(new_revision,
+			  version_file.root_to_set(Glass::SPELLING),
+			  keep_revisions);
+    docdata_table.commit(new_revision,
+			 version_file.root_to_set(Glass::DOCDATA),
+			 keep_revisions);
 
     const string & tmpfile = version_file.write(new_revision, flags);
     if (!postlist_table.sync() ||
@@ -402,6 +427,7 @@ void
 GlassDatabase::close()
 {
     LOGCALL_VOID(DB, "GlassDatabase::close", NO_ARGS);
+    term_stats_cache.clear();
     postlist_table.close(true);
     position_table.close(true);
     termlist_table.close(true);
@@ -762,7 +788,28 @@ GlassDatabase::get_freqs(const string & term,
 {
     LOGCALL_VOID(DB, "GlassDatabase::get_freqs", term | termfreq_ptr | collfreq_ptr);
     Assert(!term.empty());
-    postlist_table.get_freqs(term, termfreq_ptr, collfreq_ptr);
+    if (!readonly) {
+	postlist_table.get_freqs(term, termfreq_ptr, collfreq_ptr);
+	return;
+    }
+    TermStatsCache::Stats stats = get_term_stats(term);
+    if (termfreq_ptr) *termfreq_ptr = stats.termfreq;
+    if (collfreq_ptr) *collfreq_ptr = stats.collfreq;
+}
+
+TermStatsCache::Stats
+GlassDatabase::get_term_stats(const string& term) const
+{
+    const TermStatsCache::Stats* cached = term_stats_cache.find(term);
+    if (cached) return *cached;
+    // Reading the wdf upper bound as well costs very little once we've found
+    // the entry, and means a later get_wdf_upper_bound() call for this term
+    // is also served from the cache.
+    TermStatsCache::Stats stats;
+    postlist_table.get_freqs(term, &stats.termfreq, &stats.collfreq,
+			     &stats.wdf_upper_bound);
+    term_stats_cache.add(term, stats);
+    return stats;
 }
 
 Xapian::doccount
@@ -803,7 +850,11 @@ GlassDatabase::get_wdf_upper_bound(const string & term) const
 {
     Assert(!term.empty());
     Xapian::termcount wdfub;
-    postlist_table.get_freqs(term, NULL, NULL, &wdfub);
+    if (readonly) {
+	wdfub = get_term_stats(term).wdf_upper_bound;
+    } else {
+	postlist_table.get_freqs(term, NULL, NULL, &wdfub);
+    }
     return min(wdfub, version_file.get_wdf_upper_bound());
 }
 
@@ -1003,6 +1054,18 @@ GlassDatabase::get_uuid() const
     RETURN(version_file.get_uuid_string());
 }
 
+bool
+GlassDatabase::append_revision_key(string& key) const
+{
+    LOGCALL(DB, bool, "GlassDatabase::append_revision_key", key);
+    // A writable database can have uncommitted changes.
+    if (!is_read_only())
+	RETURN(false);
+    pack_string(key, version_file.get_uuid_string());
+    pack_uint(key, version_file.get_revision());
+    RETURN(true);
+}
+
 void
 GlassDatabase::throw_termlist_table_close_exception() const
 {
@@ -39,6 +39,7 @@
 #include "glass_version.h"
 #include "../flint_lock.h"
 #include "glass_defs.h"
+#include "backends/termstatscache.h"
 #include "backends/valuestats.h"
 
 #include "xapian/compactor.h"
@@ -116,6 +117,16 @@ class GlassDatabase : public Xapian::Database::Internal {
     /// Replication changesets.
     GlassChanges changes;
 
+    /** Statistics for recently used terms.
+     *
+     *  Only used if the database is open read-only, and cleared when a
+     *  different revision is opened.
+     */
+    mutable TermStatsCache term_stats_cache;
+
+    /// Look up the statistics for @a term, using term_stats_cache if we can.
+    TermStatsCache::Stats get_term_stats(const string& term) const;
+
     /** Return true if a database exists at the path specified for this
      *  database.
      */
@@ -298,6 +309,7 @@ class GlassDatabase : public Xapian::Database::Internal {
      */
     Xapian::rev get_revision() const;
     string get_uuid() const;
+    bool append_revision_key(string& key) const;
 
     void request_document(Xapian::docid /*did*/) const;
     void readahead_for_query(const Xapian::Query &query) const;
@@ -186,6 +186,13 @@ GlassDatabaseReplicator::process_changeset_chunk_blocks(Glass::table_type table,
     uint4 block_number;
     if (!unpack_uint(&ptr, end, &block_number))
 	throw NetworkError("Invalid block number in changeset");
+    unsigned gap_start, gap_len;
+    if (!unpack_uint(&ptr, end, &gap_start) ||
+	!unpack_uint(&ptr, end, &gap_len) ||
+	gap_start > changeset_blocksize ||
+	gap_len > changeset_blocksize - gap_start) {
+	throw NetworkError("Invalid block gap in changeset");
+    }
 
     buf.erase(0, ptr - buf.data());
 
@@ -202,12 +209,16 @@ GlassDatabaseReplicator::process_changeset_chunk_blocks(Glass::table_type table,
 	fds[table] = fd;
     }
 
-    int res = conn.get_message_chunk(buf, changeset_blocksize, end_time);
+    // The unused gap in the block isn't sent, so fill it with zeros.
+    int res = conn.get_message_chunk(buf, changeset_blocksize - gap_len,
+				     end_time);
     if (res <= 0) {
 	if (res < 0)
 	    throw_connection_closed_unexpectedly();
 	throw NetworkError("Unexpected end of changeset (4)");
     }
+    if (gap_len)
+	buf.insert(gap_start, gap_len, '\0');
 
     io_write_block(fd, buf.data(), changeset_blocksize, block_number);
     buf.erase(0, changeset_blocksize);
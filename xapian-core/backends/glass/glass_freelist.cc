@@ -232,7 +232,8 @@ GlassFreeList::mark_block_unused(const GlassTable * B, uint4 block_size, uint4 b
 }
 
 void
-GlassFreeList::commit(const GlassTable * B, uint4 block_size)
+GlassFreeList::commit(const GlassTable * B, uint4 block_size,
+		      unsigned keep_revisions)
 {
     if (pw && flw.c != 0) {
 	memset(pw + flw.c, 255, FREELIST_END - flw.c - 4);
@@ -248,7 +249,18 @@ GlassFreeList::commit(const GlassTable * B, uint4 block_size)
 	    Assert(fl.n == fl_end.n || aligned_read4(p + FREELIST_END - 4) != UNUSED);
 	}
 	flw_appending = true;
-	fl_end = flw;
+    }
+
+    if (flw.c == 0) {
+	// There's no freelist yet.
+	return;
+    }
+
+    // Hold back blocks freed in the last keep_revisions commits.
+    kept_ends.push_back(flw);
+    while (kept_ends.size() > keep_revisions) {
+	fl_end = kept_ends.front();
+	kept_ends.pop_front();
     }
 }
 
@@ -25,6 +25,8 @@
 #include "glass_defs.h"
 #include "pack.h"
 
+#include <deque>
+
 class GlassTable;
 
 class GlassFLCursor {
@@ -82,6 +84,14 @@ class GlassFreeList {
     bool flw_appending;
 
   private:
+    /** Freelist ends from recent commits which we're not using yet.
+     *
+     *  Blocks freed since the oldest entry are still used by a revision which
+     *  a reader may have open, so we don't hand them out yet.  The oldest
+     *  entry becomes fl_end when it's no longer needed.
+     */
+    std::deque<GlassFLCursor> kept_ends;
+
     /// Current freelist block.
     uint8_t * p;
 
@@ -100,6 +110,7 @@ class GlassFreeList {
 	revision = 0;
 	first_unused_block = 0;
 	flw_appending = false;
+	kept_ends.clear();
     }
 
     ~GlassFreeList() { delete [] p; delete [] pw; }
@@ -121,7 +132,17 @@ class GlassFreeList {
     // Used when compacting to a single file.
     void set_first_unused_block(uint4 base) { first_unused_block = base; }
 
-    void commit(const GlassTable * B, uint4 block_size);
+    /** Write out the freelist changes.
+     *
+     *  @param keep_revisions  Normally blocks freed before a commit can be
+     *		reused after it, so readers of the revision before the new
+     *		one may get DatabaseModifiedError.  If this is non-zero, such
+     *		blocks are instead held back for this many more commits.  This
+     *		is only tracked in memory, so it restarts when the database is
+     *		reopened for writing.
+     */
+    void commit(const GlassTable * B, uint4 block_size,
+		unsigned keep_revisions);
 
     void pack(std::string & buf) {
 	pack_uint(buf, revision);
@@ -136,7 +157,10 @@ class GlassFreeList {
 		 fl.unpack(pstart, end) &&
 		 flw.unpack(pstart, end);
 	if (r) {
-	    fl_end = flw;
+	    // If we're holding back freed blocks then fl_end has already been
+	    // set (this happens when changes are cancelled).
+	    if (kept_ends.empty())
+		fl_end = flw;
 	    flw_appending = false;
 	}
 	return r;
@@ -219,6 +219,7 @@ GlassTable::write_block(uint4 n, const uint8_t * p, bool appending) const
 
     const char * p_char = reinterpret_cast<const char *>(p);
     io_write_block(handle, p_char, block_size, n, offset);
+    sync_needed = true;
 
     if (!changes_obj) return;
 
@@ -256,13 +257,27 @@ GlassTable::write_block(uint4 n, const uint8_t * p, bool appending) const
 	return; // FIXME
     }
 
+    // Don't write out the unused gap between the end of the directory and
+    // the first item - the replica just fills it with zeros.  Freelist blocks
+    // have a different layout so are always written out in full.
+    unsigned gap_start = 0, gap_len = 0;
+    if (GET_LEVEL(p) != LEVEL_FREELIST) {
+	gap_start = DIR_END(p);
+	gap_len = MAX_FREE(p);
+	AssertRel(gap_start + gap_len, <=, block_size);
+    }
+
     string buf;
     buf += char(v);
     // Write the block number to the file
     pack_uint(buf, n);
+    pack_uint(buf, gap_start);
+    pack_uint(buf, gap_len);
 
     changes_obj->write_block(buf);
-    changes_obj->write_block(reinterpret_cast<const char *>(p), block_size);
+    changes_obj->write_block(p_char, gap_start);
+    changes_obj->write_block(p_char + gap_start + gap_len,
+			     block_size - gap_start - gap_len);
 }
 
 /* A note on cursors:
@@ -1714,6 +1729,7 @@ GlassTable::GlassTable(const char * tablename_, const string & path_,
 	  changed_c(0),
 	  max_item_size(0),
 	  Btree_modified(false),
+	  sync_needed(false),
 	  full_compaction(false),
 	  writable(!readonly_),
 	  cursor_created_since_last_modification(false),
@@ -1749,6 +1765,7 @@ GlassTable::GlassTable(const char * tablename_, int fd, off_t offset_,
 	  changed_c(0),
 	  max_item_size(0),
 	  Btree_modified(false),
+	  sync_needed(false),
 	  full_compaction(false),
 	  writable(!readonly_),
 	  cursor_created_since_last_modification(false),
@@ -1862,9 +1879,10 @@ GlassTable::flush_db()
 }
 
 void
-GlassTable::commit(glass_revision_number_t revision, RootInfo * root_info)
+GlassTable::commit(glass_revision_number_t revision, RootInfo * root_info,
+		   unsigned keep_revisions)
 {
-    LOGCALL_VOID(DB, "GlassTable::commit", revision|root_info);
+    LOGCALL_VOID(DB, "GlassTable::commit", revision|root_info|keep_revisions);
     Assert(writable);
 
     if (revision <= revision_number) {
@@ -1902,7 +1920,7 @@ GlassTable::commit(glass_revision_number_t revision, RootInfo * root_info)
 	}
 
 	free_list.set_revision(revision);
-	free_list.commit(this, block_size);
+	free_list.commit(this, block_size, keep_revisions);
 
 	// Save the freelist details into the root_info.
 	string serialised;
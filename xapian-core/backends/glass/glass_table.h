@@ -531,13 +531,24 @@ class GlassTable {
      *          needs to be greater than any previously used revision.
      *
      *  @param root_info  Information about the root is returned in this.
+     *
+     *  @param keep_revisions  Don't reuse blocks which are still used by
+     *		this many revisions before the new one (see
+     *		GlassFreeList::commit()).
      */
-    void commit(glass_revision_number_t revision, RootInfo * root_info);
+    void commit(glass_revision_number_t revision, RootInfo * root_info,
+		unsigned keep_revisions = 0);
 
     bool sync() {
-	return (flags & Xapian::DB_NO_SYNC) ||
-	       handle < 0 ||
-	       io_sync(handle);
+	// If no blocks have been written since the last sync then there's
+	// nothing to sync - with small commits this is often true for some of
+	// the tables.
+	if ((flags & Xapian::DB_NO_SYNC) || handle < 0 || !sync_needed)
+	    return true;
+	if (!io_sync(handle))
+	    return false;
+	sync_needed = false;
+	return true;
     }
 
     /** Cancel any outstanding changes.
@@ -834,6 +845,9 @@ class GlassTable {
     /// Set to true the first time the B-tree is modified.
     mutable bool Btree_modified;
 
+    /// Set when a block has been written since the table was last synced.
+    mutable bool sync_needed;
+
     /// set to true when full compaction is to be achieved
     bool full_compaction;
 
@@ -32,6 +32,7 @@
 #include "backends/backends.h"
 #include "backends/contiguousalldocspostlist.h"
 #include "backends/leafpostlist.h"
+#include "pack.h"
 #include "xapian/error.h"
 
 using namespace std;
@@ -106,8 +107,12 @@ HoneyDatabase::~HoneyDatabase()
 void
 HoneyDatabase::readahead_for_query(const Xapian::Query& query) const
 {
-    (void)query;
-    // FIXME: Implement - pre-read the start of the postlist table?
+    Xapian::TermIterator t;
+    for (t = query.get_unique_terms_begin(); t != Xapian::TermIterator(); ++t) {
+	const string& term = *t;
+	if (!postlist_table.readahead_key(Honey::make_postingchunk_key(term)))
+	    break;
+    }
 }
 
 Xapian::doccount
@@ -183,7 +188,21 @@ HoneyDatabase::get_freqs(const string& term,
 			 Xapian::doccount* termfreq_ptr,
 			 Xapian::termcount* collfreq_ptr) const
 {
-    postlist_table.get_freqs(term, termfreq_ptr, collfreq_ptr);
+    TermStatsCache::Stats stats = get_term_stats(term);
+    if (termfreq_ptr) *termfreq_ptr = stats.termfreq;
+    if (collfreq_ptr) *collfreq_ptr = stats.collfreq;
+}
+
+TermStatsCache::Stats
+HoneyDatabase::get_term_stats(const string& term) const
+{
+    const TermStatsCache::Stats* cached = term_stats_cache.find(term);
+    if (cached) return *cached;
+    TermStatsCache::Stats stats;
+    postlist_table.get_freqs(term, &stats.termfreq, &stats.collfreq,
+			     &stats.wdf_upper_bound);
+    term_stats_cache.add(term, stats);
+    return stats;
 }
 
 Xapian::doccount
@@ -228,7 +247,7 @@ HoneyDatabase::get_wdf_upper_bound(const string& term) const
 	// coll_freq, and the first wdf value, which more often than not is
 	// actually the exact bound (in 77% of cases in an example database of
 	// wikipedia data).
-	wdf_bound = min(wdf_bound, postlist_table.get_wdf_upper_bound(term));
+	wdf_bound = min(wdf_bound, get_term_stats(term).wdf_upper_bound);
     }
     return wdf_bound;
 }
@@ -457,6 +476,7 @@ HoneyDatabase::reopen()
 void
 HoneyDatabase::close()
 {
+    term_stats_cache.clear();
     docdata_table.close(true);
     postlist_table.close(true);
     position_table.close(true);
@@ -484,6 +504,14 @@ HoneyDatabase::get_uuid() const
     return version_file.get_uuid_string();
 }
 
+bool
+HoneyDatabase::append_revision_key(string& key) const
+{
+    pack_string(key, version_file.get_uuid_string());
+    pack_uint(key, version_file.get_revision());
+    return true;
+}
+
 int
 HoneyDatabase::get_backend_info(string* path_ptr) const
 {
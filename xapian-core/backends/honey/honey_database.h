@@ -23,6 +23,7 @@
 #define XAPIAN_INCLUDED_HONEY_DATABASE_H
 
 #include "backends/databaseinternal.h"
+#include "backends/termstatscache.h"
 
 #include "honey_alldocspostlist.h"
 #include "honey_docdata.h"
@@ -81,6 +82,12 @@ class HoneyDatabase : public Xapian::Database::Internal {
 
     mutable HoneyCursor* doclen_cursor = NULL;
 
+    /// Statistics for recently used terms.
+    mutable TermStatsCache term_stats_cache;
+
+    /// Look up the statistics for @a term, using term_stats_cache if we can.
+    TermStatsCache::Stats get_term_stats(const std::string& term) const;
+
     [[noreturn]]
     void throw_termlist_table_close_exception() const;
 
@@ -361,6 +368,8 @@ class HoneyDatabase : public Xapian::Database::Internal {
      */
     std::string get_uuid() const;
 
+    bool append_revision_key(std::string& key) const;
+
     /** Get backend information about this database.
      *
      *  @param path	If non-NULL, and set the pointed to string to the file
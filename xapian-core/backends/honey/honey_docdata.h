@@ -102,8 +102,10 @@ class HoneyDocDataTable : public HoneyLazyTable {
      */
     bool delete_document_data(Xapian::docid did) { return del(make_key(did)); }
 
-    void readahead_for_document(Xapian::docid did) const {
-	readahead_key(make_key(did));
+    void readahead_for_document(Xapian::docid) const {
+	// We don't use readahead_key() here as the first byte of the key only
+	// encodes the length of the docid, so the range it would hint is
+	// unlikely to contain this document's data in a large database.
     }
 };
 
@@ -29,6 +29,7 @@
 
 #include "unicode/description_append.h"
 
+#include <algorithm>
 #include <cerrno>
 
 #ifdef DEBUGGING
@@ -450,6 +451,41 @@ HoneyTable::get_exact_entry(const std::string& key, std::string* tag) const
     return true;
 }
 
+bool
+HoneyTable::readahead_key(const std::string& key) const
+{
+#ifdef SSTINDEX_ARRAY
+    if (!read_only || !store.is_open())
+	return false;
+    if (rare(key.empty()))
+	return true;
+    // Look up the initial character of the key in the index.  Any key with
+    // that initial character lies between its pointer and the next one (or
+    // the index itself for the final character), and get_exact_entry() will
+    // read through that range from the start to find the key.
+    store.rewind(root);
+    if (store.read() != 0x00)
+	return false;
+    unsigned char first = static_cast<unsigned char>(key[0] - store.read());
+    unsigned char range = store.read();
+    if (first > range)
+	return true;
+    store.skip(first * 4); // FIXME: pointer width
+    off_t start = store.read_uint4_be();
+    off_t end = first < range ? off_t(store.read_uint4_be()) : root;
+    if (end <= start)
+	return true;
+    // The range can be a sizable fraction of the table, so only hint the
+    // start of it.
+    const size_t HONEY_READAHEAD_MAX = 128 * 1024;
+    size_t len = min(size_t(end - start), HONEY_READAHEAD_MAX);
+    return store.readahead(start, len);
+#else
+    (void)key;
+    return false;
+#endif
+}
+
 HoneyCursor*
 HoneyTable::cursor_get() const
 {
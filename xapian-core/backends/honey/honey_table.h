@@ -328,6 +328,17 @@ class BufferedFile {
 	io_sync(common->fd);
     }
 
+    /** Hint that we're going to read some data soon.
+     *
+     *  @param start	The offset of the start of the data.
+     *  @param len	The length of the data.
+     *
+     *  @return false if hints aren't supported.
+     */
+    bool readahead(off_t start, size_t len) const {
+	return io_readahead_block(common->fd, len, 0, start);
+    }
+
     void rewind(off_t start) {
 	read_only = true;
 	pos = start;
@@ -671,8 +682,15 @@ class HoneyTable {
 	std::abort();
     }
 
-    // readahead probably not useful?  (FIXME)
-    bool readahead_key(const std::string&) const { return false; }
+    /** Hint that we're going to look up a key soon.
+     *
+     *  Only the start of the range of the table with the same first byte as
+     *  @a key is hinted, so this is only useful for tables where that byte
+     *  narrows things down (such as the postlist table).
+     *
+     *  @return false if there's no point making further calls.
+     */
+    bool readahead_key(const std::string& key) const;
 
     bool is_modified() const { return !read_only && !empty(); }
 
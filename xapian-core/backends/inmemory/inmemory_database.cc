@@ -123,22 +123,36 @@ InMemoryPostList::next(double /*w_min*/)
 }
 
 PostList *
-InMemoryPostList::skip_to(Xapian::docid did, double w_min)
+InMemoryPostList::skip_to(Xapian::docid did, double)
 {
     if (db->is_closed()) InMemoryDatabase::throw_database_closed();
-    // FIXME - see if we can make more efficient, perhaps using better
-    // data structure.  Note, though, that a binary search of
-    // the remaining list may NOT be a good idea (search time is then
-    // O(log {length of list}), as opposed to O(distance we want to skip)
-    // Since we will frequently only be skipping a short distance, this
-    // could well be worse.
 
     // If we've not started, it's OK to call skip_to().
     Assert(!at_end() || !started);
     started = true;
-    while (!at_end() && (*pos).did < did) {
-	(void) next(w_min);
+    if (pos == end || pos->did >= did) return NULL;
+
+    // A plain binary search of the rest of the list would be O(log {length
+    // of list}), which is worse than a linear scan for the short skips which
+    // are common.  So gallop forward in steps which double each time until
+    // we pass did, then binary search within the last step, which is
+    // O(log {distance we skip}).
+    auto lo = pos;
+    auto hi = end;
+    size_t step = 1;
+    while (step < size_t(end - lo)) {
+	if (lo[step].did >= did) {
+	    hi = lo + step;
+	    break;
+	}
+	lo += step;
+	step *= 2;
     }
+    pos = lower_bound(lo, hi, did,
+		      [](const InMemoryPosting& p, Xapian::docid d) {
+			  return p.did < d;
+		      });
+    while (pos != end && !pos->valid) ++pos;
     return NULL;
 }
 
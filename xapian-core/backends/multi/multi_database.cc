@@ -517,6 +517,16 @@ MultiDatabase::get_uuid() const
     return uuid;
 }
 
+bool
+MultiDatabase::append_revision_key(string& key) const
+{
+    for (auto&& shard : shards) {
+	if (!shard->append_revision_key(key))
+	    return false;
+    }
+    return true;
+}
+
 bool
 MultiDatabase::locked() const
 {
@@ -134,6 +134,8 @@ class MultiDatabase : public Xapian::Database::Internal {
 
     std::string get_uuid() const;
 
+    bool append_revision_key(std::string& key) const;
+
     bool locked() const;
 
     void write_changesets_to_fd(int fd,
@@ -48,37 +48,74 @@ NetworkPostList::open_position_list() const
     return db->open_position_list(lastdocid, term);
 }
 
-PostList *
-NetworkPostList::next(double)
+void
+NetworkPostList::decode_posting()
 {
-    if (!started) {
-	started = true;
-	pos = postings.data();
-	pos_end = pos + postings.size();
-	lastdocid = 0;
+    Xapian::docid inc;
+    if (!unpack_uint(&pos, pos_end, &inc) ||
+	!unpack_uint(&pos, pos_end, &lastwdf)) {
+	unpack_throw_serialisation_error(pos);
     }
+    lastdocid += inc + 1;
+    ++chunk_postings;
+}
+
+bool
+NetworkPostList::fetch_chunk(Xapian::docid did, bool grow)
+{
+    // If the server sent fewer postings than we asked for then there aren't
+    // any more.  If did is 0 then lastdocid was the largest possible docid.
+    if (chunk_postings < chunk_size || did == 0) {
+	pos = NULL;
+	return false;
+    }
+
+    // If we read through the whole of the previous chunk then ask for a
+    // bigger one this time, so long lists need fewer round trips.
+    if (grow && chunk_size < MAX_CHUNK_SIZE)
+	chunk_size *= 2;
 
+    (void)db->read_post_list_chunk(term, did, chunk_size, postings);
+    pos = postings.data();
+    pos_end = pos + postings.size();
+    lastdocid = did - 1;
+    chunk_postings = 0;
     if (pos == pos_end) {
 	pos = NULL;
-    } else {
-	Xapian::docid inc;
-	if (!unpack_uint(&pos, pos_end, &inc) ||
-	    !unpack_uint(&pos, pos_end, &lastwdf)) {
-	    unpack_throw_serialisation_error(pos);
-	}
-	lastdocid += inc + 1;
+	return false;
     }
+    return true;
+}
 
+PostList *
+NetworkPostList::next(double)
+{
+    started = true;
+    if (pos == pos_end) {
+	if (!fetch_chunk(lastdocid + 1, true)) return NULL;
+    }
+    decode_posting();
     return NULL;
 }
 
 PostList *
-NetworkPostList::skip_to(Xapian::docid did, double min_weight)
+NetworkPostList::skip_to(Xapian::docid did, double)
 {
-    if (!started)
-	next(min_weight);
-    while (pos && lastdocid < did)
-	next(min_weight);
+    if (started && (pos == NULL || did <= lastdocid))
+	return NULL;
+    started = true;
+
+    // Look through the postings we already have first.
+    while (pos != pos_end) {
+	decode_posting();
+	if (lastdocid >= did)
+	    return NULL;
+    }
+
+    // The server skips to did for us, so the first posting in the new chunk
+    // is the one we want.
+    if (fetch_chunk(did, false))
+	decode_posting();
     return NULL;
 }
 
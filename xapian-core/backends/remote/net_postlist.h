@@ -30,21 +30,56 @@
 #include "remote-database.h"
 
 /** A postlist in a remote database.
+ *
+ *  The postings are fetched from the server in chunks as they are needed,
+ *  so iterating only part of a long postlist doesn't transfer it all, and
+ *  the memory used is bounded by the chunk size.  The chunk size starts
+ *  small and doubles each time we read through a whole chunk, up to a limit,
+ *  which keeps the number of round trips down for long lists.
+ *
+ *  If skip_to() moves past the postings in the current chunk we ask the
+ *  server for a chunk starting at the target document ID so the postings
+ *  skipped over aren't transferred.
  */
 class NetworkPostList : public LeafPostList {
     friend class RemoteDatabase;
 
     Xapian::Internal::intrusive_ptr<const RemoteDatabase> db;
 
+    /// The postings in the current chunk.
     std::string postings;
     bool started = false;
-    const char* pos = NULL;
-    const char* pos_end = NULL;
+    const char* pos;
+    const char* pos_end;
 
     Xapian::docid lastdocid = 0;
     Xapian::termcount lastwdf = 0;
 
+    /// The number of postings requested for the current chunk.
+    Xapian::doccount chunk_size = FIRST_CHUNK_SIZE;
+
+    /// The number of postings decoded from the current chunk so far.
+    Xapian::doccount chunk_postings = 0;
+
+    /// Decode the next posting from the current chunk.
+    void decode_posting();
+
+    /** Fetch the next chunk of postings, starting at @a did.
+     *
+     *  @param did	The first document ID wanted.
+     *  @param grow	Ask for a bigger chunk than last time.
+     *
+     *  @return false if there are no more postings.
+     */
+    bool fetch_chunk(Xapian::docid did, bool grow);
+
   public:
+    /// The number of postings to ask for in the first chunk.
+    static constexpr Xapian::doccount FIRST_CHUNK_SIZE = 1024;
+
+    /// The maximum number of postings to ask for in a chunk.
+    static constexpr Xapian::doccount MAX_CHUNK_SIZE = 65536;
+
     /// Constructor.
     NetworkPostList(Xapian::Internal::intrusive_ptr<const RemoteDatabase> db_,
 		    const std::string& term_,
@@ -54,6 +89,8 @@ class NetworkPostList : public LeafPostList {
 	termfreq = termfreq_;
 	// collfreq is only used during the match and remote shards are handled
 	// by running the match on the remote.
+	pos = postings.data();
+	pos_end = pos + postings.size();
     }
 
     /// Get the current document ID.
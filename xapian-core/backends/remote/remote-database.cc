@@ -210,9 +210,30 @@ RemoteDatabase::open_post_list(const string& term) const
 	}
     }
 
-    send_message(MSG_POSTLIST, term);
+    // Fetch the first chunk now - we need a round trip to get the termfreq
+    // anyway.
+    string postings;
+    Xapian::doccount termfreq =
+	read_post_list_chunk(term, 1, NetworkPostList::FIRST_CHUNK_SIZE,
+			     postings);
+    return new NetworkPostList(intrusive_ptr<const RemoteDatabase>(this),
+			       term,
+			       termfreq,
+			       std::move(postings));
+}
 
+Xapian::doccount
+RemoteDatabase::read_post_list_chunk(const string& term,
+				     Xapian::docid did,
+				     Xapian::doccount max_postings,
+				     string& postings) const
+{
     string message;
+    pack_uint(message, did - 1);
+    pack_uint(message, max_postings);
+    message += term;
+    send_message(MSG_POSTLISTCHUNK, message);
+
     get_message(message, REPLY_POSTLISTHEADER);
 
     const char * p = message.data();
@@ -222,12 +243,8 @@ RemoteDatabase::open_post_list(const string& term) const
 	unpack_throw_serialisation_error(p);
     }
 
-    get_message(message, REPLY_POSTLIST);
-
-    return new NetworkPostList(intrusive_ptr<const RemoteDatabase>(this),
-			       term,
-			       termfreq,
-			       std::move(message));
+    get_message(postings, REPLY_POSTLIST);
+    return termfreq;
 }
 
 LeafPostList *
@@ -597,8 +614,12 @@ RemoteDatabase::get_message(string &result,
 {
     double end_time = RealTime::end_time(timeout);
     int type = link.get_message(result, end_time);
-    if (pending_reply && !is_intermediate_reply(type)) {
-	pending_reply = false;
+    if (pending_replies && !is_intermediate_reply(type)) {
+	if (type < 0 || type == REPLY_EXCEPTION) {
+	    pending_replies = 0;
+	} else {
+	    --pending_replies;
+	}
     }
     if (type < 0)
 	throw_connection_closed_unexpectedly();
@@ -630,18 +651,27 @@ RemoteDatabase::get_message(string &result,
 void
 RemoteDatabase::send_message(message_type type, const string &message) const
 {
-    double end_time = RealTime::end_time(timeout);
-    while (pending_reply) {
-	string dummy;
-	int reply_code = link.get_message(dummy, end_time);
-	if (reply_code < 0)
-	    throw_connection_closed_unexpectedly();
-	if (!is_intermediate_reply(reply_code)) {
-	    pending_reply = false;
-	}
+    while (pending_replies) {
+	discard_reply();
     }
+    double end_time = RealTime::end_time(timeout);
     link.send_message(static_cast<unsigned char>(type), message, end_time);
-    pending_reply = true;
+    pending_replies = 1;
+}
+
+void
+RemoteDatabase::discard_reply() const
+{
+    double end_time = RealTime::end_time(timeout);
+    string dummy;
+    int reply_code = link.get_message(dummy, end_time);
+    if (reply_code < 0)
+	throw_connection_closed_unexpectedly();
+    if (reply_code == REPLY_EXCEPTION) {
+	pending_replies = 0;
+    } else if (!is_intermediate_reply(reply_code)) {
+	--pending_replies;
+    }
 }
 
 void
@@ -733,17 +763,19 @@ RemoteDatabase::accumulate_remote_stats(Xapian::Weight::Internal& total) const
     total += remote_stats;
 }
 
-void
-RemoteDatabase::send_global_stats(Xapian::doccount first,
-				  Xapian::doccount maxitems,
-				  Xapian::doccount check_at_least,
-				  const Xapian::KeyMaker* sorter,
-				  const Xapian::Weight::Internal &stats) const
+/// Serialise the parts of MSG_GETMSET before the global stats.
+static string
+serialise_getmset(Xapian::doccount first,
+		  Xapian::doccount maxitems,
+		  Xapian::doccount check_at_least,
+		  const Xapian::KeyMaker* sorter,
+		  bool cancelled)
 {
     string message;
     pack_uint(message, first);
     pack_uint(message, maxitems);
     pack_uint(message, check_at_least);
+    pack_bool(message, cancelled);
     if (!sorter) {
 	pack_string_empty(message);
     } else {
@@ -754,10 +786,67 @@ RemoteDatabase::send_global_stats(Xapian::doccount first,
 	pack_string(message, name);
 	pack_string(message, sorter->serialise());
     }
+    return message;
+}
+
+void
+RemoteDatabase::send_global_stats(Xapian::doccount first,
+				  Xapian::doccount maxitems,
+				  Xapian::doccount check_at_least,
+				  const Xapian::KeyMaker* sorter,
+				  const Xapian::Weight::Internal &stats,
+				  bool cancelled) const
+{
+    string message = serialise_getmset(first, maxitems, check_at_least,
+				       sorter, cancelled);
     message += serialise_stats(stats);
     send_message(MSG_GETMSET, message);
 }
 
+void
+RemoteDatabase::start_single_match(Xapian::doccount first,
+				   Xapian::doccount maxitems,
+				   Xapian::doccount check_at_least,
+				   const Xapian::KeyMaker* sorter,
+				   bool cancelled) const
+{
+    // Omitting the global stats tells the server to use its own.  We're
+    // still waiting for REPLY_STATS, so don't use send_message() here as that
+    // would wait for it before sending.
+    string message = serialise_getmset(first, maxitems, check_at_least,
+				       sorter, cancelled);
+    double end_time = RealTime::end_time(timeout);
+    link.send_message(static_cast<unsigned char>(MSG_GETMSET), message,
+		      end_time);
+    ++pending_replies;
+}
+
+void
+RemoteDatabase::cancel_match() const
+{
+    // The server doesn't reply to MSG_CANCELMATCH, and we're still waiting
+    // for the reply to MSG_GETMSET, so don't use send_message() here.
+    double end_time = RealTime::end_time(timeout);
+    link.send_message(static_cast<unsigned char>(MSG_CANCELMATCH), string(),
+		      end_time);
+}
+
+void
+RemoteDatabase::abandon_match(bool getmset_sent) const
+{
+    if (getmset_sent) {
+	cancel_match();
+	return;
+    }
+    // The server will wait for MSG_GETMSET after sending REPLY_STATS, so send
+    // one which tells it to use its own stats and not to run the match.
+    string message = serialise_getmset(0, 0, 0, NULL, true);
+    double end_time = RealTime::end_time(timeout);
+    link.send_message(static_cast<unsigned char>(MSG_GETMSET), message,
+		      end_time);
+    ++pending_replies;
+}
+
 Xapian::MSet
 RemoteDatabase::get_mset(const vector<opt_ptr_spy>& matchspies) const
 {
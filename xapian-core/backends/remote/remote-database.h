@@ -72,15 +72,19 @@ class RemoteDatabase : public Xapian::Database::Internal {
     /// Has positional information?
     mutable bool has_positional_info;
 
-    /** Are we currently expecting a reply?
+    /** How many replies are we currently expecting?
      *
      *  Our caller might send a message but then an exception (from another
      *  shard or locally) might cause it not to try to read the reply before
-     *  sending another message.  This flag allows us to detect that situation
-     *  and discard the unwanted reply rather than trying to read it as the
-     *  response to the new message.
+     *  sending another message.  This count allows us to detect that
+     *  situation and discard the unwanted replies rather than trying to read
+     *  them as the response to the new message.
+     *
+     *  A search can be waiting for both REPLY_STATS and REPLY_RESULTS if
+     *  MSG_GETMSET was sent without waiting for REPLY_STATS.  REPLY_EXCEPTION
+     *  ends the whole exchange.
      */
-    mutable bool pending_reply = false;
+    mutable unsigned pending_replies = 0;
 
     /// The UUID of the remote database.
     mutable std::string uuid;
@@ -213,6 +217,11 @@ class RemoteDatabase : public Xapian::Database::Internal {
 	return link.get_read_fd();
     }
 
+    /// Has any of the next reply already been read into our buffer?
+    bool input_buffered() const {
+	return link.input_buffered();
+    }
+
     /// Accumulate stats from the remote server.
     void accumulate_remote_stats(Xapian::Weight::Internal& total) const;
 
@@ -221,7 +230,41 @@ class RemoteDatabase : public Xapian::Database::Internal {
 			   Xapian::doccount maxitems,
 			   Xapian::doccount check_at_least,
 			   const Xapian::KeyMaker* sorter,
-			   const Xapian::Weight::Internal &stats) const;
+			   const Xapian::Weight::Internal &stats,
+			   bool cancelled) const;
+
+    /** Start the match when this is the only shard.
+     *
+     *  The remote server's stats are then the global stats, so we ask it to
+     *  use them without waiting to receive them first, which saves a round
+     *  trip.  Used instead of send_global_stats(), and before
+     *  accumulate_remote_stats().
+     */
+    void start_single_match(Xapian::doccount first,
+			    Xapian::doccount maxitems,
+			    Xapian::doccount check_at_least,
+			    const Xapian::KeyMaker* sorter,
+			    bool cancelled) const;
+
+    /** Ask the remote server to stop the match early.
+     *
+     *  Called after send_global_stats() and before get_mset().
+     */
+    void cancel_match() const;
+
+    /** Give up on the current match without waiting for its results.
+     *
+     *  The replies are discarded when they arrive.
+     *
+     *  @param getmset_sent	Has MSG_GETMSET been sent yet?
+     */
+    void abandon_match(bool getmset_sent) const;
+
+    /// Are we still waiting for replies to earlier messages?
+    bool replies_pending() const { return pending_replies != 0; }
+
+    /// Read and discard a reply to an earlier message.
+    void discard_reply() const;
 
     /// Get the MSet from the remote server.
     Xapian::MSet get_mset(const std::vector<opt_ptr_spy>& matchspies) const;
@@ -247,7 +290,19 @@ class RemoteDatabase : public Xapian::Database::Internal {
 
     LeafPostList* open_leaf_post_list(const std::string& term, bool) const;
 
-    Xapian::doccount read_post_list(const std::string& term, NetworkPostList & pl) const;
+    /** Fetch a chunk of a postlist from the server.
+     *
+     *  @param term		The term (empty for all documents).
+     *  @param did		Return postings for document IDs >= this.
+     *  @param max_postings	Return at most this many postings.
+     *  @param postings		Set to the encoded postings.
+     *
+     *  @return The term frequency.
+     */
+    Xapian::doccount read_post_list_chunk(const std::string& term,
+					  Xapian::docid did,
+					  Xapian::doccount max_postings,
+					  std::string& postings) const;
 
     PositionList * open_position_list(Xapian::docid did,
 				      const std::string& tname) const;
@@ -0,0 +1,87 @@
+/** @file
+ * @brief Cache of statistics for terms in a database revision.
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_TERMSTATSCACHE_H
+#define XAPIAN_INCLUDED_TERMSTATSCACHE_H
+
+#include <string>
+#include <unordered_map>
+
+#include "xapian/types.h"
+
+/** Cache of statistics for terms in a database revision.
+ *
+ *  Every search looks up the statistics for each term in the query before
+ *  it starts reading postings, so a database which is used to run many
+ *  searches benefits from keeping the statistics for frequently searched
+ *  terms in memory.
+ *
+ *  The owner is responsible for calling clear() when the revision it is
+ *  reading changes.
+ */
+class TermStatsCache {
+  public:
+    /// Statistics for a term.
+    struct Stats {
+	/// The number of documents the term indexes.
+	Xapian::doccount termfreq;
+
+	/// The total number of occurrences of the term.
+	Xapian::termcount collfreq;
+
+	/// An upper bound on the wdf of the term.
+	Xapian::termcount wdf_upper_bound;
+    };
+
+  private:
+    /** The maximum number of terms to cache.
+     *
+     *  When the cache is full we just empty it - terms which are searched for
+     *  frequently will be added back quickly, and this avoids the space and
+     *  time overheads of tracking which entries are least recently used.
+     */
+    static constexpr size_t MAX_ENTRIES = 10000;
+
+    /// The cached statistics, keyed by term.
+    std::unordered_map<std::string, Stats> entries;
+
+  public:
+    /** Look up the statistics for a term.
+     *
+     *  @return Pointer to the statistics, or NULL if @a term isn't cached.
+     *		The pointer is invalidated by a subsequent call to add() or
+     *		clear().
+     */
+    const Stats* find(const std::string& term) const {
+	auto i = entries.find(term);
+	return i == entries.end() ? NULL : &i->second;
+    }
+
+    /// Add the statistics for a term.
+    void add(const std::string& term, const Stats& stats) {
+	if (entries.size() >= MAX_ENTRIES) entries.clear();
+	entries.emplace(term, stats);
+    }
+
+    /// Remove all cached statistics.
+    void clear() { entries.clear(); }
+};
+
+#endif // XAPIAN_INCLUDED_TERMSTATSCACHE_H
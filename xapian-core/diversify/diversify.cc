@@ -78,82 +78,99 @@ Diversify::get_dmset(const MSet& mset)
 void
 Diversify::Internal::initialise_points(const MSet& source)
 {
-    unsigned int count = 0;
+    points.clear();
+    index_of.clear();
+    scores.clear();
+    main_dmset.clear();
+
+    points.reserve(source.size());
+    scores.reserve(source.size());
     TermListGroup tlg(source);
     for (MSetIterator it = source.begin(); it != source.end(); ++it) {
-	points.emplace(*it, Xapian::Point(tlg, it.get_document()));
-	scores[*it] = it.get_weight();
+	unsigned i = points.size();
+	Xapian::Document doc = it.get_document();
+	points.emplace_back(tlg, doc);
+	// Key on the Document's docid since that's what we get back from the
+	// documents in the ClusterSet.
+	index_of.emplace(doc.get_docid(), i);
+	scores.push_back(it.get_weight());
 	// Initial top-k diversified documents
-	if (count < k) {
-	    main_dmset.push_back(*it);
-	    ++count;
+	if (i < k) {
+	    main_dmset.push_back(i);
 	}
     }
 }
 
-pair<Xapian::docid, unsigned int>
-Diversify::Internal::get_key(Xapian::docid doc_id, unsigned int centroid_id)
-{
-    return make_pair(doc_id, centroid_id);
-}
-
 void
 Diversify::Internal::compute_similarities(const Xapian::ClusterSet& cset)
 {
     Xapian::CosineDistance d;
-    for (auto p : points) {
-	Xapian::docid point_id = p.first;
-	Xapian::Point point = p.second;
-	for (unsigned int c = 0; c < cset.size(); ++c) {
-	    double dist = d.similarity(point, cset[c].get_centroid());
-	    auto key = get_key(point_id, c);
-	    pairwise_sim[key] = dist;
+    num_clusters = cset.size();
+    pairwise_sim.resize(points.size() * num_clusters);
+    for (unsigned c = 0; c < num_clusters; ++c) {
+	const Xapian::Centroid& centroid = cset[c].get_centroid();
+	for (unsigned i = 0; i < points.size(); ++i) {
+	    pairwise_sim[i * num_clusters + c] =
+		d.similarity(points[i], centroid);
 	}
     }
 }
 
-vector<Xapian::docid>
-Diversify::Internal::compute_diff_dmset(const vector<Xapian::docid>& dmset)
+void
+Diversify::Internal::update_min_distances(const vector<unsigned>& dmset)
 {
-    vector<Xapian::docid> diff_dmset;
-    for (auto point : points) {
-	Xapian::docid point_id = point.first;
-	bool found_point = false;
-	for (auto doc_id : dmset) {
-	    if (point_id == doc_id) {
-		found_point = true;
-		break;
+    min_dist.assign(num_clusters, numeric_limits<double>::max());
+    second_min_dist.assign(num_clusters, numeric_limits<double>::max());
+    min_pos.assign(num_clusters, 0);
+    for (unsigned c = 0; c < num_clusters; ++c) {
+	for (unsigned pos = 0; pos < dmset.size(); ++pos) {
+	    double weight = weighted_distance(dmset[pos], pos, c);
+	    if (weight < min_dist[c]) {
+		second_min_dist[c] = min_dist[c];
+		min_dist[c] = weight;
+		min_pos[c] = pos;
+	    } else if (weight < second_min_dist[c]) {
+		second_min_dist[c] = weight;
 	    }
 	}
+    }
+}
+
+double
+Diversify::Internal::evaluate_dmset(const vector<unsigned>& dmset) const
+{
+    double score_1 = 0, score_2 = 0;
 
-	if (!found_point) {
-	    diff_dmset.push_back(point_id);
+    for (auto i : dmset)
+	score_1 += scores[i];
+
+    for (unsigned c = 0; c < num_clusters; ++c) {
+	double min_d = numeric_limits<double>::max();
+	for (unsigned pos = 0; pos < dmset.size(); ++pos) {
+	    min_d = min(min_d, weighted_distance(dmset[pos], pos, c));
 	}
+	score_2 += min_d;
     }
 
-    return diff_dmset;
+    return -lambda * score_1 + (1 - lambda) * score_2;
 }
 
 double
-Diversify::Internal::evaluate_dmset(const vector<Xapian::docid>& dmset,
-				    const Xapian::ClusterSet& cset)
+Diversify::Internal::evaluate_swap(const vector<unsigned>& dmset,
+				   unsigned pos,
+				   unsigned candidate) const
 {
     double score_1 = 0, score_2 = 0;
 
-    for (auto doc_id : dmset)
-	score_1 += scores[doc_id];
+    // Sum in the same order as evaluate_dmset() so we get exactly the same
+    // result for the same dmset.
+    for (unsigned p = 0; p < dmset.size(); ++p)
+	score_1 += scores[p == pos ? candidate : dmset[p]];
 
-    for (unsigned int c = 0; c < cset.size(); ++c) {
-	double min_dist = numeric_limits<double>::max();
-	unsigned int pos = 1;
-	for (auto doc_id : dmset) {
-	    auto key = get_key(doc_id, c);
-	    double sim = pairwise_sim[key];
-	    double weight = 2 * b * sigma_sqr / log(1 + pos) * (1 - sim);
-	    min_dist = min(min_dist, weight);
-	    ++pos;
-	}
-	score_2 += min_dist;
+    for (unsigned c = 0; c < num_clusters; ++c) {
+	// The minimum over the positions other than pos.
+	double min_d = (min_pos[c] == pos) ? second_min_dist[c] : min_dist[c];
+	score_2 += min(min_d, weighted_distance(candidate, pos, c));
     }
 
     return -lambda * score_1 + (1 - lambda) * score_2;
@@ -181,49 +198,53 @@ Diversify::Internal::get_dmset(const MSet& mset)
     Xapian::ClusterSet cset = lc.cluster(mset);
     compute_similarities(cset);
 
+    pos_weight.resize(main_dmset.size());
+    for (unsigned pos = 0; pos < main_dmset.size(); ++pos)
+	pos_weight[pos] = 2 * b * sigma_sqr / log(2 + pos);
+
     // topC contains union of top-r relevant documents of each cluster
-    vector<Xapian::docid> topc;
+    vector<unsigned> topc;
 
     // Build topC
     for (unsigned int c = 0; c < cset.size(); ++c) {
 	auto documents = cset[c].get_documents();
 	for (unsigned int d = 0; d < r && d < documents.size(); ++d) {
-	    auto doc_id = documents[d].get_docid();
-	    topc.push_back(doc_id);
+	    topc.push_back(index_of.at(documents[d].get_docid()));
 	}
     }
 
-    vector<Xapian::docid> curr_dmset = main_dmset;
+    // Flags which documents are in curr_dmset, so we can skip candidates
+    // already present without searching curr_dmset.
+    vector<bool> in_dmset(points.size(), false);
+    for (auto i : main_dmset)
+	in_dmset[i] = true;
+
+    vector<unsigned> curr_dmset = main_dmset;
 
     while (true) {
 	bool found_better_dmset = false;
 	for (unsigned int i = 0; i < main_dmset.size(); ++i) {
-	    auto curr_doc = main_dmset[i];
-	    double best_score = evaluate_dmset(curr_dmset, cset);
+	    auto curr_doc = curr_dmset[i];
+	    update_min_distances(curr_dmset);
+	    double best_score = evaluate_dmset(curr_dmset);
 	    bool found_better_doc = false;
 
-	    for (unsigned int j = 0; j < topc.size(); ++j) {
+	    for (auto candidate : topc) {
 		// Continue if candidate document from topC already
 		// exists in curr_dmset
-		auto candidate_doc = find(curr_dmset.begin(), curr_dmset.end(),
-					  topc[j]);
-		if (candidate_doc != curr_dmset.end()) {
+		if (in_dmset[candidate])
 		    continue;
-		}
-
-		auto temp_doc = curr_dmset[i];
-		curr_dmset[i] = topc[j];
-		double score = evaluate_dmset(curr_dmset, cset);
 
+		double score = evaluate_swap(curr_dmset, i, candidate);
 		if (score < best_score) {
-		    curr_doc = curr_dmset[i];
+		    curr_doc = candidate;
 		    best_score = score;
 		    found_better_doc = true;
 		}
-
-		curr_dmset[i] = temp_doc;
 	    }
 	    if (found_better_doc) {
+		in_dmset[curr_dmset[i]] = false;
+		in_dmset[curr_doc] = true;
 		curr_dmset[i] = curr_doc;
 		found_better_dmset = true;
 	    }
@@ -237,14 +258,16 @@ Diversify::Internal::get_dmset(const MSet& mset)
 	main_dmset = curr_dmset;
     }
 
-    // Merge main_dmset and diff_dmset into final dmset
+    // Merge main_dmset and the remaining documents (in mset order) into final
+    // dmset
     DocumentSet dmset;
-    for (auto doc_id : main_dmset)
-	dmset.add_document(points.at(doc_id).get_document());
+    for (auto i : main_dmset)
+	dmset.add_document(points[i].get_document());
 
-    vector<Xapian::docid> diff_dmset = compute_diff_dmset(main_dmset);
-    for (auto doc_id : diff_dmset)
-	dmset.add_document(points.at(doc_id).get_document());
+    for (unsigned i = 0; i < points.size(); ++i) {
+	if (!in_dmset[i])
+	    dmset.add_document(points[i].get_document());
+    }
 
     return dmset;
 }
@@ -24,7 +24,7 @@
 
 #include <xapian/intrusive_ptr.h>
 
-#include <map>
+#include <unordered_map>
 #include <vector>
 
 /** Internal class for Diversify
@@ -45,17 +45,56 @@ class Xapian::Diversify::Internal : public Xapian::Internal::intrusive_base {
     /// MPT parameters
     double lambda, b, sigma_sqr;
 
-    /// Store each document from given mset as a point
-    std::unordered_map<Xapian::docid, Xapian::Point> points;
+    /** Documents from the given mset, in mset order.
+     *
+     *  Documents are referred to internally by their index in this vector,
+     *  which is also the row index into @a pairwise_sim.
+     */
+    std::vector<Xapian::Point> points;
+
+    /// Map docid to its index in @a points
+    std::unordered_map<Xapian::docid, unsigned> index_of;
+
+    /// Relevance score of each entry in @a points
+    std::vector<double> scores;
+
+    /// Number of clusters (and so columns in @a pairwise_sim)
+    unsigned num_clusters = 0;
+
+    /** Cosine similarities between documents and cluster centroids.
+     *
+     *  Dense row-major matrix with one row per entry in @a points and one
+     *  column per cluster.
+     */
+    std::vector<double> pairwise_sim;
 
-    /// Store the relevance score of each document
-    std::unordered_map<Xapian::docid, double> scores;
+    /** MPT position weight for each position in the diversified set.
+     *
+     *  The factor 2 * b * sigma_sqr / log(1 + pos) only depends on the
+     *  (1-based) position so we precompute it once.
+     */
+    std::vector<double> pos_weight;
 
-    /// Store pairwise cosine similarities of documents of given mset
-    std::map<std::pair<Xapian::docid, Xapian::docid>, double> pairwise_sim;
+    /** Per-cluster minimum term of the MPT objective for the current dmset.
+     *
+     *  For each cluster we track the smallest and second smallest weighted
+     *  distance over the positions in the current dmset, and the position
+     *  at which the smallest occurs.  This allows the effect on the
+     *  objective of replacing the document at one position to be evaluated
+     *  in O(number of clusters) rather than O(k * number of clusters).
+     */
+    std::vector<double> min_dist, second_min_dist;
 
-    /// Store docids of top k diversified documents
-    std::vector<Xapian::docid> main_dmset;
+    /// Position in the current dmset at which min_dist occurs
+    std::vector<unsigned> min_pos;
+
+    /// Indices of top k diversified documents
+    std::vector<unsigned> main_dmset;
+
+    /// Return the weighted distance of document @a i at position @a pos
+    double weighted_distance(unsigned i, unsigned pos, unsigned c) const {
+	return pos_weight[pos] * (1 - pairwise_sim[i * num_clusters + c]);
+    }
 
   public:
     /// Constructor for initialising diversification parameters
@@ -76,46 +115,48 @@ class Xapian::Diversify::Internal : public Xapian::Internal::intrusive_base {
      */
     void initialise_points(const Xapian::MSet& source);
 
-    /** Return a key for a pair of documents
-     *
-     *  Returns a key as a pair of given documents ids
-     *
-     *  @param doc_id	Document id of the document
-     *  @param centroid_idx	Index of cluster to which the given centroid
-     *  			belongs to in the cluster set
-     */
-    std::pair<Xapian::docid, unsigned int>
-    get_key(Xapian::docid doc_id, unsigned int centroid_idx);
-
     /** Compute pairwise similarities
      *
-     *  Used for pre-computing pairwise cosine similarities of documents
-     *  of given mset, which is used to speed up evaluate_dmset
+     *  Used for pre-computing cosine similarities between each document
+     *  of given mset and each cluster centroid, which is used to speed up
+     *  evaluating candidate dmsets.
      *
      *  @param cset	Cluster of given relevant documents
      */
     void compute_similarities(const Xapian::ClusterSet& cset);
 
-    /** Return difference of 'points' and current dmset
+    /** Recompute the per-cluster minimum distances for a dmset
      *
-     *  Return the difference of 'points' and the current diversified
-     *  document match set
-     *
-     *  @param dmset	Document set representing a diversified document set
+     *  @param dmset	Indices of the documents in the diversified set
      */
-    std::vector<Xapian::docid>
-    compute_diff_dmset(const std::vector<Xapian::docid>& dmset);
+    void update_min_distances(const std::vector<unsigned>& dmset);
 
     /** Evaluate a diversified mset
      *
-     *  Evaluate a diversified mset using MPT algorithm
+     *  Evaluate a diversified mset using MPT algorithm.  This evaluates
+     *  the dmset in full, using O(k * number of clusters) time.
+     *
+     *  @param dmset	Indices of the documents in the candidate
+     *			diversified set
+     */
+    double evaluate_dmset(const std::vector<unsigned>& dmset) const;
+
+    /** Evaluate a dmset with one document replaced
+     *
+     *  Returns the same value as evaluate_dmset() would for @a dmset with
+     *  the document at position @a pos replaced by @a candidate, but uses
+     *  the per-cluster minimum distances computed by
+     *  update_min_distances() for @a dmset so only takes
+     *  O(k + number of clusters) time.
      *
-     *  @param dmset	Set of points representing candidate diversifed
-     *			set of documents
-     *  @param cset	Set of clusters of given mset
+     *  @param dmset	Indices of the documents in the current
+     *			diversified set
+     *  @param pos	Position in @a dmset to replace
+     *  @param candidate	Index of the replacement document
      */
-    double evaluate_dmset(const std::vector<Xapian::docid>& dmset,
-			  const Xapian::ClusterSet& cset);
+    double evaluate_swap(const std::vector<unsigned>& dmset,
+			 unsigned pos,
+			 unsigned candidate) const;
 
     /// Return diversified document set from given mset
     Xapian::DocumentSet get_dmset(const MSet& mset);
@@ -69,8 +69,10 @@
 
 // Searching
 #include <xapian/enquire.h>
+#include <xapian/cancelflag.h>
 #include <xapian/eset.h>
 #include <xapian/mset.h>
+#include <xapian/msetcache.h>
 #include <xapian/expanddecider.h>
 #include <xapian/keymaker.h>
 #include <xapian/matchdecider.h>
@@ -0,0 +1,105 @@
+/** @file
+ *  @brief Flag which can be used to stop a running search
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_CANCELFLAG_H
+#define XAPIAN_INCLUDED_CANCELFLAG_H
+
+#if !defined XAPIAN_IN_XAPIAN_H && !defined XAPIAN_LIB_BUILD
+# error Never use <xapian/cancelflag.h> directly; include <xapian.h> instead.
+#endif
+
+#include <string>
+
+#include <xapian/intrusive_ptr.h>
+#include <xapian/visibility.h>
+
+namespace Xapian {
+
+/** Flag which can be used to stop a running search.
+ *
+ *  This allows an application which runs searches on worker threads to stop
+ *  one which is no longer wanted - for example, because the client which
+ *  asked for it has gone away, or a deadline has passed.  Pass the flag to
+ *  Enquire::set_cancel_flag() before calling Enquire::get_mset(), and call
+ *  cancel() from any thread (or from a signal handler) to stop the search.
+ *
+ *  Unlike the other methods of this class, cancel() and is_cancelled() may be
+ *  called while another thread is using the flag.  Copying, assigning and
+ *  destroying CancelFlag objects which refer to the same flag must still only
+ *  happen from one thread at a time, so the thread running the search should
+ *  copy the flag before the search starts.
+ *
+ *  @since Added in Xapian 1.5.0.
+ */
+class XAPIAN_VISIBILITY_DEFAULT CancelFlag {
+  public:
+    /// Class representing the CancelFlag internals.
+    class Internal;
+    /// @private @internal Reference counted internals.
+    Xapian::Internal::intrusive_ptr_nonnull<Internal> internal;
+
+    /** Copy constructor.
+     *
+     *  The internals are reference counted, so copying is cheap, and the copy
+     *  refers to the same flag.
+     */
+    CancelFlag(const CancelFlag& o);
+
+    /** Assignment operator.
+     *
+     *  The internals are reference counted, so assignment is cheap, and the
+     *  object assigned to then refers to the same flag as @a o.
+     */
+    CancelFlag& operator=(const CancelFlag& o);
+
+    /// Move constructor.
+    CancelFlag(CancelFlag&& o);
+
+    /// Move assignment operator.
+    CancelFlag& operator=(CancelFlag&& o);
+
+    /// Construct a flag which isn't set.
+    CancelFlag();
+
+    /// Destructor.
+    ~CancelFlag();
+
+    /** Set the flag.
+     *
+     *  Any search using this flag stops as soon as it notices.
+     */
+    void cancel();
+
+    /// Return true if cancel() has been called since the flag was reset.
+    bool is_cancelled() const;
+
+    /** Clear the flag.
+     *
+     *  This allows the flag to be reused for another search.
+     */
+    void reset();
+
+    /// Return a string describing this object.
+    std::string get_description() const;
+};
+
+}
+
+#endif // XAPIAN_INCLUDED_CANCELFLAG_H
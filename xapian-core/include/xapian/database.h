@@ -188,6 +188,13 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
      *  can recover from this situation by calling reopen() and restarting
      *  the search operation.
      *
+     *  With the glass backend, if the writer has XAPIAN_KEEP_REVISIONS set
+     *  to N in its environment then blocks still used by the N revisions
+     *  before the latest aren't reused, so a reader can lag behind by up to
+     *  N commits before it has to reopen.  This uses more disk space, and
+     *  only starts from the first commit after the writer opens the
+     *  database.
+     *
      *  All shards are updated to the latest available revision.  This should
      *  be a cheap operation if they're already at the latest revision, so
      *  if you're using the same Database object for many searches it's
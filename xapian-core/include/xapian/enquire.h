@@ -40,11 +40,13 @@
 namespace Xapian {
 
 // Forward declarations of classes referenced below.
+class CancelFlag;
 class Database;
 class ExpandDecider;
 class KeyMaker;
 class MatchDecider;
 class MatchSpy;
+class MSetCache;
 class Query;
 class RSet;
 class Weight;
@@ -353,11 +355,88 @@ class XAPIAN_VISIBILITY_DEFAULT Enquire {
      *
      *  This feature is currently supported on platforms which support POSIX
      *  interval timers.  Interaction with the remote backend when using
-     *  multiple databases may have bugs.  There's not currently a way to
-     *  force the match to end after a certain time.
+     *  multiple databases may have bugs.  To force the match to end after a
+     *  certain time, call Xapian::CancelFlag::cancel() from a timer (see
+     *  @a set_cancel_flag()).
      */
     void set_time_limit(double time_limit);
 
+    /** Use a cache of search results.
+     *
+     *  @a get_mset() will return results from @a cache when it can, and add
+     *  the results of searches it runs to @a cache.  See Xapian::MSetCache
+     *  for details of which searches can be cached.
+     *
+     *  By default no cache is used.
+     *
+     *  @param cache	The cache to use.  This can be shared with other
+     *			Enquire objects, including ones searching other
+     *			databases.
+     */
+    void set_mset_cache(const MSetCache& cache);
+
+    /** Stop using a cache of search results.
+     *
+     *  Any cache set by @a set_mset_cache() is no longer used by this object
+     *  (the cache itself isn't cleared).
+     */
+    void clear_mset_cache();
+
+    /** Set a flag which can be used to stop a running match.
+     *
+     *  If @a flag is set while @a get_mset() is running then the match stops
+     *  as soon as it notices, and @a get_mset() returns the results found so
+     *  far, with Xapian::MSet::was_cancelled() returning true.  These may
+     *  omit documents which would otherwise have been returned, and the
+     *  number of matches is estimated rather than counted.  If the flag is
+     *  already set when @a get_mset() is called then no documents are
+     *  returned.
+     *
+     *  Remote servers are also asked to stop their part of the match.
+     *
+     *  Searches using a cancel flag aren't added to or answered from a cache
+     *  set with @a set_mset_cache(), since their results may be incomplete.
+     *
+     *  By default no flag is used.
+     *
+     *  @param flag	The flag to check.  See Xapian::CancelFlag for which
+     *			methods can be called from other threads.
+     */
+    void set_cancel_flag(const CancelFlag& flag);
+
+    /** Stop using a flag set by @a set_cancel_flag(). */
+    void clear_cancel_flag();
+
+    /** Set a time limit on waiting for remote shards.
+     *
+     *  If some remote shards haven't replied @a deadline seconds after
+     *  @a get_mset() starts, it stops waiting for them and returns results
+     *  from the other shards.  Xapian::MSet::get_missing_shard_count() and
+     *  Xapian::MSet::was_shard_missing() report which shards were left out.
+     *
+     *  When searching several shards, each needs to send its statistics
+     *  before any can run the match.  Shards which haven't done so half way
+     *  to the deadline are left out, so that the others have time to finish.
+     *
+     *  A shard which misses the deadline is asked to stop matching, and its
+     *  late replies are discarded when they arrive.  If they still haven't
+     *  arrived when the next search with a deadline starts, that search
+     *  leaves the shard out too.
+     *
+     *  Searches using a deadline aren't added to or answered from a cache set
+     *  with @a set_mset_cache(), since their results may be incomplete.
+     *
+     *  @param deadline	time in seconds to wait for remote shards (default:
+     *			0.0 which means to wait until the connection times
+     *			out)
+     *
+     *  Limitations:
+     *
+     *  This feature needs poll(), so isn't currently supported on Microsoft
+     *  Windows.
+     */
+    void set_remote_deadline(double deadline);
+
     /** Run the query.
      *
      *  Run the query using the settings in this Enquire object and those
@@ -236,6 +236,32 @@ class XAPIAN_VISIBILITY_DEFAULT MSet {
     /** The maximum possible weight any document could achieve. */
     double get_max_possible() const;
 
+    /** Was the match stopped early by a cancellation request?
+     *
+     *  See Enquire::set_cancel_flag().  If this returns true then some
+     *  documents which would otherwise have been returned may be missing,
+     *  and the number of matches is estimated from the part of the match
+     *  which was run rather than counted exactly.
+     */
+    bool was_cancelled() const;
+
+    /** Number of shards which were left out of the match.
+     *
+     *  See Enquire::set_remote_deadline().  If this is non-zero then the
+     *  results only come from the shards which replied in time.  The upper
+     *  bounds on the number of matches allow for every document in the
+     *  missing shards matching, and the estimates assume they would have
+     *  matched at the same rate as the shards which were searched.
+     */
+    Xapian::doccount get_missing_shard_count() const;
+
+    /** Was a particular shard left out of the match?
+     *
+     *  @param shard	Index of the shard in the Database which was searched
+     *			(starting from 0).
+     */
+    bool was_shard_missing(Xapian::doccount shard) const;
+
     enum {
 	/** Model the relevancy of non-query terms in MSet::snippet().
 	 *
@@ -0,0 +1,131 @@
+/** @file
+ *  @brief Cache of search results which can be shared between Enquire objects
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_MSETCACHE_H
+#define XAPIAN_INCLUDED_MSETCACHE_H
+
+#if !defined XAPIAN_IN_XAPIAN_H && !defined XAPIAN_LIB_BUILD
+# error Never use <xapian/msetcache.h> directly; include <xapian.h> instead.
+#endif
+
+#include <cstddef>
+#include <string>
+
+#include <xapian/intrusive_ptr.h>
+#include <xapian/visibility.h>
+
+namespace Xapian {
+
+/** Cache of search results.
+ *
+ *  An MSetCache can be shared by any number of Enquire objects (see
+ *  Enquire::set_mset_cache()), so a single cache can be used for all the
+ *  searches a process runs.  Repeated searches then return results from the
+ *  cache without running the match again.  A search for a later page of
+ *  results can also use a cached search for earlier pages, as each search
+ *  which is added to the cache is run for all the results up to the page
+ *  asked for.
+ *
+ *  Searches are only cached if the Database they are run against identifies
+ *  the revision it is reading (which is currently the case for glass and
+ *  honey databases which are open read-only, and for combinations of such
+ *  databases).  The revision forms part of the key, so results cached before
+ *  a commit() or reopen() aren't used afterwards.
+ *
+ *  Searches which use an RSet, a MatchDecider, a MatchSpy or a time limit
+ *  aren't cached, and neither are searches using a Query, Weight or KeyMaker
+ *  object which can't be serialised.
+ *
+ *  A cached MSet returns the same documents, weights and percentages as a
+ *  fresh search would.  Its match count bounds and estimates come from the
+ *  search which was cached, which will have checked at least as many
+ *  documents as the one being answered from the cache.
+ *
+ *  Like other Xapian objects, an MSetCache object which is used from more
+ *  than one thread needs to be protected by a lock.
+ *
+ *  @since Added in Xapian 1.5.0.
+ */
+class XAPIAN_VISIBILITY_DEFAULT MSetCache {
+  public:
+    /// Class representing the MSetCache internals.
+    class Internal;
+    /// @private @internal Reference counted internals.
+    Xapian::Internal::intrusive_ptr_nonnull<Internal> internal;
+
+    /** Copy constructor.
+     *
+     *  The internals are reference counted, so copying is cheap, and the copy
+     *  refers to the same cache.
+     */
+    MSetCache(const MSetCache& o);
+
+    /** Assignment operator.
+     *
+     *  The internals are reference counted, so assignment is cheap, and the
+     *  object assigned to then refers to the same cache as @a o.
+     */
+    MSetCache& operator=(const MSetCache& o);
+
+    /// Move constructor.
+    MSetCache(MSetCache&& o);
+
+    /// Move assignment operator.
+    MSetCache& operator=(MSetCache&& o);
+
+    /** Construct a new cache.
+     *
+     *  @param max_size	Approximate limit on the memory used by cached
+     *			results, in bytes.  When adding a search would exceed
+     *			this, the least recently used searches are dropped.
+     */
+    explicit MSetCache(size_t max_size);
+
+    /// Destructor.
+    ~MSetCache();
+
+    /// Return the approximate memory used by cached results, in bytes.
+    size_t get_size() const;
+
+    /// Return the limit on the memory used by cached results, in bytes.
+    size_t get_max_size() const;
+
+    /// Return the number of searches currently cached.
+    size_t get_entry_count() const;
+
+    /// Return the number of searches which were answered from the cache.
+    unsigned long get_hits() const;
+
+    /** Return the number of cacheable searches not answered from the cache.
+     *
+     *  Searches which can't be cached aren't counted.
+     */
+    unsigned long get_misses() const;
+
+    /// Drop all cached results (the hit and miss counts are kept).
+    void clear();
+
+    /// Return a string describing this object.
+    std::string get_description() const;
+};
+
+}
+
+#endif // XAPIAN_INCLUDED_MSETCACHE_H
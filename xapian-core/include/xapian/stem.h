@@ -30,6 +30,7 @@
 #include <xapian/intrusive_ptr.h>
 #include <xapian/visibility.h>
 
+#include <cstddef>
 #include <string>
 
 namespace Xapian {
@@ -58,7 +59,12 @@ class XAPIAN_VISIBILITY_DEFAULT StemImplementation
     virtual std::string get_description() const = 0;
 };
 
-/// Class representing a stemming algorithm.
+/** Class representing a stemming algorithm.
+ *
+ *  Copies of a Stem object share the same stemming algorithm object (and
+ *  cache of results, if one is enabled), so like other Xapian objects a Stem
+ *  object and its copies should only be used from one thread at a time.
+ */
 class XAPIAN_VISIBILITY_DEFAULT Stem {
   public:
     /// @private @internal Reference counted internals.
@@ -162,6 +168,44 @@ class XAPIAN_VISIBILITY_DEFAULT Stem {
     /// Return true if this is a no-op stemmer.
     bool is_none() const { return !internal; }
 
+    /** Set the size of the cache of stemmed words.
+     *
+     *  Indexing text typically stems the same common words over and over
+     *  again, so caching the results of the stemming algorithm can speed it
+     *  up considerably.  The cache is disabled by default.
+     *
+     *  Each word maps to a particular slot in the cache, and a word which
+     *  isn't in the cache replaces the word in its slot, so the number of
+     *  words cached is bounded without needing to track which are used
+     *  least.  The results returned are the same whether or not the cache is
+     *  used.
+     *
+     *  Calling this method replaces any existing cache, and resets the cache
+     *  statistics.  Copies of this object made before the call aren't
+     *  affected, while copies made afterwards share the cache.  This method
+     *  has no effect on a no-op stemmer.
+     *
+     *  @param size	The maximum number of words to cache (this is rounded
+     *			down to a power of two).  0 disables the cache.
+     *
+     *  @since Added in Xapian 1.5.0.
+     */
+    void set_cache_size(size_t size);
+
+    /** Return the number of words which were stemmed using the cache.
+     *
+     *  @since Added in Xapian 1.5.0.
+     */
+    unsigned long get_cache_hits() const;
+
+    /** Return the number of words which were stemmed without the cache.
+     *
+     *  Only calls made when the cache is enabled are counted.
+     *
+     *  @since Added in Xapian 1.5.0.
+     */
+    unsigned long get_cache_misses() const;
+
     /// Return a string describing this object.
     std::string get_description() const;
 
@@ -30,6 +30,7 @@
 #include <xapian/unicode.h>
 #include <xapian/visibility.h>
 
+#include <cstddef>
 #include <string>
 
 namespace Xapian {
@@ -73,6 +74,32 @@ class XAPIAN_VISIBILITY_DEFAULT TermGenerator {
     /// Set the Xapian::Stem object to be used for generating stemmed terms.
     void set_stemmer(const Xapian::Stem & stemmer);
 
+    /** Get the Xapian::Stem object used for generating stemmed terms.
+     *
+     *  This shares any cache of stemmed words with the TermGenerator, so can
+     *  be used to find the cache statistics.
+     *
+     *  @since Added in Xapian 1.5.0.
+     */
+    const Xapian::Stem & get_stemmer() const;
+
+    /** Set the size of the cache of stemmed words.
+     *
+     *  A cache can make indexing with a stemmer much faster, as the same
+     *  common words are stemmed over and over again.  If @a size is
+     *  non-zero, the TermGenerator uses its own cache of this size, which
+     *  replaces any cache set on a Xapian::Stem object passed to
+     *  set_stemmer() (now or later).  See Xapian::Stem::set_cache_size() for
+     *  details.
+     *
+     *  @param size	The maximum number of words to cache.  The default is
+     *			0, which means to use whatever cache the Xapian::Stem
+     *			object has.
+     *
+     *  @since Added in Xapian 1.5.0.
+     */
+    void set_stemmer_cache_size(size_t size);
+
     /** Set the Xapian::Stopper object to be used for identifying stopwords.
      *
      *  Stemmed forms of stopwords aren't indexed, but unstemmed forms still
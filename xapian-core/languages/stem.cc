@@ -25,6 +25,7 @@
 
 #include <xapian/error.h>
 
+#include "stemcache.h"
 #include "steminternal.h"
 
 #include "allsnowballheaders.h"
@@ -145,6 +146,34 @@ Stem::operator()(const std::string &word) const
     return internal->operator()(word);
 }
 
+void
+Stem::set_cache_size(size_t size)
+{
+    if (!internal) return;
+    StemImplementation* stemmer = internal.get();
+    auto cached = dynamic_cast<CachedStemImplementation*>(stemmer);
+    if (cached) stemmer = cached->get_stemmer();
+    if (size) {
+	internal = new CachedStemImplementation(stemmer, size);
+    } else {
+	internal = stemmer;
+    }
+}
+
+unsigned long
+Stem::get_cache_hits() const
+{
+    auto cached = dynamic_cast<CachedStemImplementation*>(internal.get());
+    return cached ? cached->get_hits() : 0;
+}
+
+unsigned long
+Stem::get_cache_misses() const
+{
+    auto cached = dynamic_cast<CachedStemImplementation*>(internal.get());
+    return cached ? cached->get_misses() : 0;
+}
+
 string
 Stem::get_description() const
 {
@@ -0,0 +1,113 @@
+/** @file
+ * @brief Cache of the results of a stemming algorithm
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_STEMCACHE_H
+#define XAPIAN_INCLUDED_STEMCACHE_H
+
+#include <xapian/stem.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+/** Stemming algorithm which caches the results of another.
+ *
+ *  Xapian::Stem::set_cache_size() wraps the Stem object's StemImplementation
+ *  in one of these, so the cache is shared by copies of the Stem in the same
+ *  way as the stemming algorithm is.
+ *
+ *  Each word maps to a single slot, chosen by hashing the word.  On a miss
+ *  the stem is calculated and replaces whatever was in the slot, so no
+ *  bookkeeping is needed to bound the size of the cache, and the words which
+ *  are stemmed most often tend to stay cached.
+ */
+class CachedStemImplementation : public Xapian::StemImplementation {
+    /// A cached result.
+    struct Entry {
+	/// The word, or empty for an unused slot.
+	std::string word;
+
+	/// The stem of word.
+	std::string stem;
+    };
+
+    /// The stemming algorithm whose results are cached.
+    Xapian::Internal::intrusive_ptr<Xapian::StemImplementation> stemmer;
+
+    /// The slots, of which there are a power of two.
+    std::unique_ptr<Entry[]> entries;
+
+    /// The number of slots.
+    size_t size;
+
+    /// The number of lookups answered from the cache.
+    unsigned long hits = 0;
+
+    /// The number of lookups which needed the stem calculating.
+    unsigned long misses = 0;
+
+  public:
+    /** Construct.
+     *
+     *  @param stemmer_	The stemming algorithm.
+     *  @param max_entries	The maximum number of results to cache.  The
+     *				number of slots is this rounded down to a power
+     *				of two.  Must be non-zero.
+     */
+    CachedStemImplementation(Xapian::StemImplementation* stemmer_,
+			     size_t max_entries)
+	: stemmer(stemmer_) {
+	size = 1;
+	while (size <= max_entries / 2) size *= 2;
+	entries.reset(new Entry[size]);
+    }
+
+    /** Stem a word, using the cache if possible.
+     *
+     *  @param word	The word to stem, which must be non-empty.
+     */
+    std::string operator()(const std::string& word) override {
+	Entry& entry = entries[std::hash<std::string>()(word) & (size - 1)];
+	if (entry.word == word) {
+	    ++hits;
+	    return entry.stem;
+	}
+	++misses;
+	std::string stem = (*stemmer)(word);
+	entry.word = word;
+	entry.stem = stem;
+	return stem;
+    }
+
+    std::string get_description() const override {
+	return stemmer->get_description();
+    }
+
+    /// Return the stemming algorithm whose results are cached.
+    Xapian::StemImplementation* get_stemmer() const { return stemmer.get(); }
+
+    /// Return the number of lookups answered from the cache.
+    unsigned long get_hits() const { return hits; }
+
+    /// Return the number of lookups which needed the stem calculating.
+    unsigned long get_misses() const { return misses; }
+};
+
+#endif // XAPIAN_INCLUDED_STEMCACHE_H
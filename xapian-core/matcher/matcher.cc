@@ -32,6 +32,7 @@
 #include "omassert.h"
 #include "postlisttree.h"
 #include "protomset.h"
+#include "realtime.h"
 #include "spymaster.h"
 #include "valuestreamdocument.h"
 #include "weight/weightinternal.h"
@@ -45,6 +46,7 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cfloat> // For DBL_EPSILON.
 #include <vector>
@@ -75,6 +77,32 @@ static void unimplemented(const char* msg)
     throw Xapian::UnimplementedError(msg);
 }
 
+#ifdef HAVE_POLL
+/** Wait for input to read from @a fd.
+ *
+ *  @return false if there's still nothing to read once @a end_time passes.
+ */
+static bool
+wait_for_input(int fd, double end_time)
+{
+    struct pollfd fds;
+    fds.fd = fd;
+    fds.events = POLLIN;
+    while (true) {
+	fds.revents = 0;
+	double time_left = end_time - RealTime::now();
+	// Round up so we don't wake up just before the end time.
+	int timeout_ms = time_left > 0.0 ? int(time_left * 1000.0) + 1 : 0;
+	int r = poll(&fds, 1, timeout_ms);
+	if (r >= 0) return r > 0;
+	if (errno != EINTR && errno != EAGAIN) {
+	    throw Xapian::NetworkError("poll() failed waiting for remote",
+				       errno);
+	}
+    }
+}
+#endif
+
 template<typename Action>
 inline void
 Matcher::for_all_remotes(Action action)
@@ -176,6 +204,87 @@ Matcher::for_all_remotes(Action action)
     }
 #endif
 }
+
+void
+Matcher::wait_for_remotes(const atomic<bool>* cancel_flag,
+			  bool getmset_sent,
+			  double end_time)
+{
+    // The remotes which we're still waiting for.
+    vector<RemoteSubMatch*> waiting;
+    waiting.reserve(remotes.size());
+    for (auto&& submatch : remotes) {
+	// The server only sends each reply once it's ready, so if any of the
+	// reply has already been read there's nothing to wait for.
+	if (!submatch->input_buffered())
+	    waiting.push_back(submatch.get());
+    }
+    auto cancelled = [cancel_flag]() {
+	return cancel_flag && cancel_flag->load(memory_order_relaxed);
+    };
+#ifdef HAVE_POLL
+    unique_ptr<struct pollfd[]> fds(new struct pollfd[waiting.size()]);
+    while (!waiting.empty() && !cancelled()) {
+	// Wake up every 10ms to check cancel_flag.
+	int timeout_ms = cancel_flag ? 10 : -1;
+	if (end_time != 0.0) {
+	    double time_left = end_time - RealTime::now();
+	    if (time_left <= 0.0) break;
+	    // Round up so we don't wake up just before the end time.
+	    int ms = int(time_left * 1000.0) + 1;
+	    if (timeout_ms < 0 || ms < timeout_ms) timeout_ms = ms;
+	}
+	for (size_t i = 0; i != waiting.size(); ++i) {
+	    fds[i].fd = waiting[i]->get_read_fd();
+	    fds[i].events = POLLIN;
+	    fds[i].revents = 0;
+	}
+	int r = poll(fds.get(), waiting.size(), timeout_ms);
+	if (r < 0) {
+	    if (errno == EINTR || errno == EAGAIN) {
+		continue;
+	    }
+	    throw Xapian::NetworkError("poll() failed waiting for remotes",
+				       errno);
+	}
+	size_t j = 0;
+	for (size_t i = 0; i != waiting.size(); ++i) {
+	    if (!fds[i].revents) waiting[j++] = waiting[i];
+	}
+	waiting.resize(j);
+    }
+#else
+    // Without poll() we only check cancel_flag once the local part of the
+    // match is done, and then ask all the remotes to stop.  There's no
+    // end_time to check as the constructor doesn't set remote_end_time.
+#endif
+    if (waiting.empty()) {
+	return;
+    }
+    if (cancelled()) {
+	if (getmset_sent) {
+	    for (auto submatch : waiting) {
+		submatch->cancel_match();
+	    }
+	}
+	return;
+    }
+    if (end_time == 0.0) {
+	return;
+    }
+
+    // Drop the remotes which didn't reply in time.
+    for (auto submatch : waiting) {
+	submatch->abandon_match(getmset_sent);
+	add_missing_shard(submatch->get_shard(), submatch->get_doccount());
+    }
+    auto dropped = [&waiting](const unique_ptr<RemoteSubMatch>& submatch) {
+	return find(waiting.begin(), waiting.end(), submatch.get()) !=
+	       waiting.end();
+    };
+    remotes.erase(remove_if(remotes.begin(), remotes.end(), dropped),
+		  remotes.end());
+}
 #endif
 
 Matcher::Matcher(const Xapian::Database& db_,
@@ -194,12 +303,29 @@ Matcher::Matcher(const Xapian::Database& db_,
 		 Xapian::Enquire::Internal::sort_setting sort_by,
 		 bool sort_val_reverse,
 		 double time_limit,
+		 double remote_deadline,
 		 const vector<opt_intrusive_ptr<Xapian::MatchSpy>>& matchspies)
     : db(db_)
 {
     // An empty query should get handled higher up.
     Assert(!query.empty());
 
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+    // When to give up waiting for remote shards to send their stats.
+    double stats_end_time = 0.0;
+#endif
+#if defined XAPIAN_HAS_REMOTE_BACKEND && defined HAVE_POLL
+    remote_end_time = RealTime::end_time(remote_deadline);
+    if (remote_end_time != 0.0) {
+	// Otherwise one slow shard could use up all the time, leaving none
+	// for the other shards to run the match in.
+	stats_end_time = remote_end_time - remote_deadline * 0.5;
+    }
+#else
+    // We need poll() to wait for remotes with a time limit.
+    (void)remote_deadline;
+#endif
+
     Xapian::doccount n_shards = db.internal->size();
     vector<Xapian::RSet> subrsets;
     if (rset && rset->internal) {
@@ -222,6 +348,22 @@ Matcher::Matcher(const Xapian::Database& db_,
 		unimplemented("Xapian::MatchDecider not supported by the "
 			      "remote backend");
 	    }
+# ifdef HAVE_POLL
+	    if (stats_end_time != 0.0) {
+		// Read any replies left from a match we gave up waiting for
+		// earlier.  If they don't arrive in time, leave this shard out.
+		while (as_rem->replies_pending() &&
+		       (as_rem->input_buffered() ||
+			wait_for_input(as_rem->get_read_fd(),
+				       stats_end_time))) {
+		    as_rem->discard_reply();
+		}
+		if (as_rem->replies_pending()) {
+		    add_missing_shard(i, as_rem->get_doccount());
+		    continue;
+		}
+	    }
+# endif
 	    as_rem->set_query(query, query_length,
 			      collapse_key, collapse_max,
 			      order, sort_key, sort_by, sort_val_reverse,
@@ -330,10 +472,17 @@ Matcher::Matcher(const Xapian::Database& db_,
     }
 
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
-    for_all_remotes(
-	[&](RemoteSubMatch* submatch) {
-	    submatch->prepare_match(stats);
-	});
+    // For a single remote shard, get_mset() collects the stats.
+    single_remote = (locals.empty() && remotes.size() == 1);
+    if (!single_remote) {
+	if (stats_end_time != 0.0) {
+	    wait_for_remotes(NULL, false, stats_end_time);
+	}
+	for_all_remotes(
+	    [&](RemoteSubMatch* submatch) {
+		submatch->prepare_match(stats);
+	    });
+    }
 #endif
 }
 
@@ -354,6 +503,8 @@ Matcher::get_local_mset(Xapian::doccount first,
 			Xapian::Enquire::Internal::sort_setting sort_by,
 			bool sort_val_reverse,
 			double time_limit,
+			const atomic<bool>* cancel_flag,
+			int cancel_fd,
 			const vector<opt_ptr_spy>& matchspies)
 {
     Assert(!locals.empty());
@@ -491,10 +642,16 @@ Matcher::get_local_mset(Xapian::doccount first,
 			 percent_threshold, percent_threshold_factor,
 			 max_possible,
 			 stop_once_full,
-			 time_limit);
+			 time_limit,
+			 cancel_flag,
+			 cancel_fd);
     proto_mset.set_new_min_weight(weight_threshold);
 
     while (true) {
+	if (proto_mset.cancelled()) {
+	    break;
+	}
+
 	double min_weight = proto_mset.get_min_weight();
 	if (!pltree.next(min_weight)) {
 	    break;
@@ -575,16 +732,30 @@ Matcher::get_mset(Xapian::doccount first,
 		  Xapian::Enquire::Internal::sort_setting sort_by,
 		  bool sort_val_reverse,
 		  double time_limit,
+		  const atomic<bool>* cancel_flag,
+		  int cancel_fd,
 		  const vector<opt_intrusive_ptr<Xapian::MatchSpy>>& matchspies)
 {
     AssertRel(check_at_least, >=, first + maxitems);
 
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
-    if (locals.empty() && remotes.size() == 1) {
-	// Short cut for a single remote database.
+    if (single_remote) {
+	// Short cut for a single remote database.  Its stats are the global
+	// stats, so it can use them without us sending them back.
 	Assert(remotes[0]);
-	remotes[0]->start_match(first, maxitems, check_at_least, sorter,
-				stats);
+	remotes[0]->start_single_match(first, maxitems, check_at_least,
+				       sorter,
+				       cancel_flag &&
+				       cancel_flag->load(memory_order_relaxed));
+	if (remote_end_time != 0.0) {
+	    wait_for_remotes(NULL, true, remote_end_time);
+	    if (remotes.empty()) return Xapian::MSet();
+	}
+	remotes[0]->prepare_match(stats);
+	if (cancel_flag || remote_end_time != 0.0) {
+	    wait_for_remotes(cancel_flag, true, remote_end_time);
+	    if (remotes.empty()) return Xapian::MSet();
+	}
 	return remotes[0]->get_mset(matchspies);
     }
 #endif
@@ -610,7 +781,9 @@ Matcher::get_mset(Xapian::doccount first,
 	    remote_maxitems = check_at_least;
 	}
 	submatch->start_match(0, remote_maxitems, check_at_least, sorter,
-			      stats);
+			      stats,
+			      cancel_flag &&
+			      cancel_flag->load(memory_order_relaxed));
     }
 #endif
 
@@ -648,7 +821,8 @@ Matcher::get_mset(Xapian::doccount first,
 				    percent_threshold,
 				    local_percent_threshold_factor,
 				    weight_threshold, order, sort_key, sort_by,
-				    sort_val_reverse, time_limit, matchspies);
+				    sort_val_reverse, time_limit,
+				    cancel_flag, cancel_fd, matchspies);
     }
 
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
@@ -657,6 +831,10 @@ Matcher::get_mset(Xapian::doccount first,
 	return local_mset;
     }
 
+    if (cancel_flag || remote_end_time != 0.0) {
+	wait_for_remotes(cancel_flag, true, remote_end_time);
+    }
+
     // We need to merge MSet objects.  We only need the number of remote shards
     // + 1 if there are any local shards, so reserving n_shards may be more
     // than we need.
@@ -686,7 +864,13 @@ Matcher::get_mset(Xapian::doccount first,
 	    msets.push_back({local_mset, 0});
 	merged_mset.internal->merge_stats(local_mset.internal.get(),
 					  collapse_max != 0);
-	merged_mset.internal->stats->merge(stats);
+	auto& merged_stats = merged_mset.internal->stats;
+	if (!merged_stats) {
+	    // All the remotes were dropped from the match.
+	    merged_stats.reset(new Xapian::Weight::Internal(stats));
+	} else {
+	    merged_stats->merge(stats);
+	}
     }
 
     if (merged_mset.internal->max_possible == 0.0) {
@@ -838,3 +1022,39 @@ Matcher::get_mset(Xapian::doccount first,
     return local_mset;
 #endif
 }
+
+void
+Matcher::report_missing_shards(Xapian::MSet& mset)
+{
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+    if (missing_shards.empty()) {
+	return;
+    }
+    sort(missing_shards.begin(), missing_shards.end());
+    auto& mseti = *mset.internal;
+    mseti.missing_shards = missing_shards;
+
+    // Any of the documents in the missing shards might match.
+    mseti.matches_upper_bound += missing_doccount;
+    mseti.uncollapsed_upper_bound += missing_doccount;
+
+    // Assume the missing shards match at the same rate as those searched.
+    Xapian::doccount total_doccount = db.get_doccount();
+    Xapian::doccount searched_doccount = total_doccount - missing_doccount;
+    if (searched_doccount == 0) {
+	return;
+    }
+    double scale = double(total_doccount) / searched_doccount;
+    auto scale_estimate = [scale](Xapian::doccount& estimate,
+				  Xapian::doccount upper_bound) {
+	double scaled = estimate * scale + 0.5;
+	estimate = scaled < upper_bound ? Xapian::doccount(scaled)
+					: upper_bound;
+    };
+    scale_estimate(mseti.matches_estimated, mseti.matches_upper_bound);
+    scale_estimate(mseti.uncollapsed_estimated,
+		   mseti.uncollapsed_upper_bound);
+#else
+    (void)mset;
+#endif
+}
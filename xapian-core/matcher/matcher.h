@@ -32,6 +32,7 @@
 
 #include "xapian/database.h"
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -85,6 +86,24 @@ class Matcher {
      */
     std::size_t first_nonselectable;
 # endif
+
+    /** Is this a search of a single remote shard?
+     *
+     *  If so, get_mset() collects its stats rather than the constructor.
+     */
+    bool single_remote = false;
+
+    /** When to give up waiting for remote shards.
+     *
+     *  0.0 means wait until the connection times out.
+     */
+    double remote_end_time = 0.0;
+
+    /// Shards dropped from the match, in ascending order once the match ends.
+    std::vector<Xapian::doccount> missing_shards;
+
+    /// Number of documents in the shards in @a missing_shards.
+    Xapian::doccount missing_doccount = 0;
 #endif
 
     Matcher(const Matcher&) = delete;
@@ -107,11 +126,36 @@ class Matcher {
 				Xapian::Enquire::Internal::sort_setting sort_by,
 				bool sort_val_reverse,
 				double time_limit,
+				const std::atomic<bool>* cancel_flag,
+				int cancel_fd,
 				const std::vector<opt_ptr_spy>& matchspies);
 
     /// Perform action on remotes as they become ready using poll() or select().
     template<typename Action> void for_all_remotes(Action action);
 
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+    /** Wait until all remotes have a reply ready.
+     *
+     *  If @a cancel_flag is set, the remotes which are still matching are
+     *  asked to stop early.  Remotes which haven't replied by @a end_time
+     *  are dropped from the match and added to @a missing_shards.
+     *
+     *  @param cancel_flag	if not NULL, stop waiting once this is set.
+     *  @param getmset_sent	Have the remotes been sent MSG_GETMSET?
+     *  @param end_time		when to stop waiting (0.0 means don't).
+     */
+    void wait_for_remotes(const std::atomic<bool>* cancel_flag,
+			  bool getmset_sent,
+			  double end_time);
+
+    /// Record that @a shard has been dropped from the match.
+    void add_missing_shard(Xapian::doccount shard,
+			   Xapian::doccount shard_doccount) {
+	missing_shards.push_back(shard);
+	missing_doccount += shard_doccount;
+    }
+#endif
+
   public:
     /** Constructor.
      *
@@ -134,6 +178,8 @@ class Matcher {
      *  @param sort_val_reverse	Reverse direction keys sort in?
      *  @param time_limit	time in seconds after which to disable
      *				check_at_least (0.0 means don't).
+     *  @param remote_deadline	time in seconds after which to stop waiting
+     *				for remote shards (0.0 means don't).
      *  @param matchspies	MatchSpy objects to use
      */
     Matcher(const Xapian::Database& db_,
@@ -152,6 +198,7 @@ class Matcher {
 	    Xapian::Enquire::Internal::sort_setting sort_by,
 	    bool sort_val_reverse,
 	    double time_limit,
+	    double remote_deadline,
 	    const std::vector<opt_ptr_spy>& matchspies);
 
     /** Run the match and produce an MSet object.
@@ -188,6 +235,10 @@ class Matcher {
      *  @param sort_val_reverse	Reverse direction keys sort in?
      *  @param time_limit	time in seconds after which to disable
      *				check_at_least (0.0 means don't).
+     *  @param cancel_flag	if not NULL, stop the match once this is set
+     *				(see Xapian::CancelFlag).
+     *  @param cancel_fd	if not -1, stop the match once this fd is
+     *				readable (used by the remote server).
      *  @param matchspies	MatchSpy objects to use
      */
     Xapian::MSet get_mset(Xapian::doccount first,
@@ -206,7 +257,16 @@ class Matcher {
 			  Xapian::Enquire::Internal::sort_setting sort_by,
 			  bool sort_val_reverse,
 			  double time_limit,
+			  const std::atomic<bool>* cancel_flag,
+			  int cancel_fd,
 			  const std::vector<opt_ptr_spy>& matchspies);
+
+    /** Note any shards which were dropped from the match in @a mset.
+     *
+     *  The bounds and estimates of the number of matches are adjusted to
+     *  allow for the documents in those shards.
+     */
+    void report_missing_shards(Xapian::MSet& mset);
 };
 
 #endif // XAPIAN_INCLUDED_MATCHER_H
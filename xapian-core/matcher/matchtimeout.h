@@ -26,6 +26,79 @@
 # error config.h must be included first in each C++ source file
 #endif
 
+#include <atomic>
+
+#ifdef HAVE_POLL_H
+# include <poll.h>
+#else
+# include "safesysselect.h"
+#endif
+
+/** Check if the match has been asked to stop early.
+ *
+ *  The request can come from a flag set by another thread (see
+ *  Xapian::CancelFlag), or from input becoming ready on a file descriptor,
+ *  which is how the remote server notices the client cancelling the match.
+ */
+class MatchCancel {
+    /// If not NULL, flag which is set if the match should stop.
+    const std::atomic<bool>* flag;
+
+    /// If not -1, fd which becomes readable if the match should stop.
+    int fd;
+
+    /// How many more calls to cancelled() before we next check @a fd.
+    unsigned fd_countdown = 0;
+
+    /// Set once we've seen a request to stop.
+    bool seen = false;
+
+    /// Is input ready on @a fd?
+    bool fd_ready() const {
+#ifdef HAVE_POLL
+	struct pollfd pfd;
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	return poll(&pfd, 1, 0) > 0;
+#else
+	fd_set fds;
+	FD_ZERO(&fds);
+	FD_SET(fd, &fds);
+	struct timeval tv;
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+	return select(fd + 1, &fds, NULL, NULL, &tv) > 0;
+#endif
+    }
+
+  public:
+    /** Constructor.
+     *
+     *  @param flag_	If not NULL, flag which is set (possibly from another
+     *			thread) if the match should stop.
+     *  @param fd_	If not -1, fd which becomes readable if the match
+     *			should stop.
+     */
+    MatchCancel(const std::atomic<bool>* flag_, int fd_)
+	: flag(flag_), fd(fd_) { }
+
+    /// Has the match been asked to stop?
+    bool cancelled() {
+	if (!seen) {
+	    if (flag && flag->load(std::memory_order_relaxed)) {
+		seen = true;
+	    } else if (fd != -1 && fd_countdown-- == 0) {
+		// Checking fd needs a system call, so only do so every so
+		// often.
+		fd_countdown = 1024;
+		seen = fd_ready();
+	    }
+	}
+	return seen;
+    }
+};
+
 #ifdef HAVE_TIMER_CREATE
 #include "realtime.h"
 
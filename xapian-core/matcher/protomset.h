@@ -128,6 +128,15 @@ class ProtoMSet {
 
     TimeOut timeout;
 
+    MatchCancel cancel;
+
+    /** Set if the match was stopped early by a cancellation request.
+     *
+     *  In this case we may not have seen all the matching documents, so
+     *  finalise() needs to use the estimates rather than the exact counts.
+     */
+    bool was_cancelled = false;
+
     Xapian::doccount size() const { return Xapian::doccount(results.size()); }
 
   public:
@@ -144,7 +153,9 @@ class ProtoMSet {
 	      double percent_threshold_factor_,
 	      double max_possible_,
 	      bool stop_once_full_,
-	      double time_limit)
+	      double time_limit,
+	      const std::atomic<bool>* cancel_flag,
+	      int cancel_fd)
 	: max_size(first_ + max_items),
 	  check_at_least(check_at_least_),
 	  sort_by(sort_by_),
@@ -157,7 +168,8 @@ class ProtoMSet {
 	  collapser(collapse_key, collapse_max, results, mcmp),
 	  max_possible(max_possible_),
 	  stop_once_full(stop_once_full_),
-	  timeout(time_limit)
+	  timeout(time_limit),
+	  cancel(cancel_flag, cancel_fd)
     {
 	results.reserve(max_size);
     }
@@ -183,6 +195,12 @@ class ProtoMSet {
 	}
     }
 
+    /// Check if the match has been cancelled, and note it if so.
+    bool cancelled() {
+	if (cancel.cancelled()) was_cancelled = true;
+	return was_cancelled;
+    }
+
     bool checked_enough() {
 	if (known_matching_docs >= check_at_least) {
 	    return true;
@@ -498,10 +516,12 @@ class ProtoMSet {
 	Xapian::doccount uncollapsed_estimated;
 	Xapian::doccount uncollapsed_upper_bound;
 
-	if (!collapser && (!full() || known_matching_docs < check_at_least)) {
+	if (!collapser && !was_cancelled &&
+	    (!full() || known_matching_docs < check_at_least)) {
 	    // Under these conditions we know exactly how many matching docs
 	    // there are for the full match so we don't need to resolve the
-	    // EstimateOp stack.
+	    // EstimateOp stack.  That's not true if the match was cancelled, as
+	    // we may have stopped before seeing all the matching documents.
 	    Xapian::doccount m;
 	    if (!full()) {
 		// We didn't get all the results requested, so we know that
@@ -547,7 +567,7 @@ class ProtoMSet {
 	    uncollapsed_estimated = matches_estimated;
 	    uncollapsed_upper_bound = matches_upper_bound;
 
-	    if (!full()) {
+	    if (!full() && !was_cancelled) {
 		// We didn't get all the results requested, so we know that we've
 		// got all there are, and the bounds and estimate are all equal to
 		// that number.
@@ -706,17 +726,19 @@ class ProtoMSet {
 	AssertRel(matches_estimated, <=, uncollapsed_estimated);
 	AssertRel(matches_upper_bound, <=, uncollapsed_upper_bound);
 
-	return Xapian::MSet(new Xapian::MSet::Internal(first,
-						       matches_upper_bound,
-						       matches_lower_bound,
-						       matches_estimated,
-						       uncollapsed_upper_bound,
-						       uncollapsed_lower_bound,
-						       uncollapsed_estimated,
-						       max_possible,
-						       max_weight,
-						       std::move(results),
-						       percent_scale * 100.0));
+	Xapian::MSet mset(new Xapian::MSet::Internal(first,
+						     matches_upper_bound,
+						     matches_lower_bound,
+						     matches_estimated,
+						     uncollapsed_upper_bound,
+						     uncollapsed_lower_bound,
+						     uncollapsed_estimated,
+						     max_possible,
+						     max_weight,
+						     std::move(results),
+						     percent_scale * 100.0));
+	if (was_cancelled) mset.internal->set_cancelled();
+	return mset;
     }
 };
 
@@ -52,6 +52,11 @@ class RemoteSubMatch {
 	return db->get_read_fd();
     }
 
+    /// Has any of the remote's reply already been buffered?
+    bool input_buffered() const {
+	return db->input_buffered();
+    }
+
     /** Fetch and collate statistics.
      *
      *  Before we can calculate term weights we need to fetch statistics from
@@ -71,14 +76,55 @@ class RemoteSubMatch {
      *  @param check_at_least The minimum number of items to check.
      *  @param sorter	      KeyMaker for sort keys (NULL for none).
      *  @param total_stats    The total statistics for the collection.
+     *  @param cancelled      Has the match already been cancelled?
      */
     void start_match(Xapian::doccount first,
 		     Xapian::doccount maxitems,
 		     Xapian::doccount check_at_least,
 		     const Xapian::KeyMaker* sorter,
-		     const Xapian::Weight::Internal& total_stats) {
+		     const Xapian::Weight::Internal& total_stats,
+		     bool cancelled) {
 	db->send_global_stats(first, maxitems, check_at_least, sorter,
-			      total_stats);
+			      total_stats, cancelled);
+    }
+
+    /** Start the match when this is the only shard.
+     *
+     *  Used instead of start_match(), and before rather than after
+     *  prepare_match(), which saves a round trip.
+     *
+     *  @param first          The first item in the result set to return.
+     *  @param maxitems       The maximum number of items to return.
+     *  @param check_at_least The minimum number of items to check.
+     *  @param sorter	      KeyMaker for sort keys (NULL for none).
+     *  @param cancelled      Has the match already been cancelled?
+     */
+    void start_single_match(Xapian::doccount first,
+			    Xapian::doccount maxitems,
+			    Xapian::doccount check_at_least,
+			    const Xapian::KeyMaker* sorter,
+			    bool cancelled) {
+	db->start_single_match(first, maxitems, check_at_least, sorter,
+			       cancelled);
+    }
+
+    /// Ask the remote to stop the match early.
+    void cancel_match() {
+	db->cancel_match();
+    }
+
+    /** Give up on the match without waiting for the remote's reply.
+     *
+     *  @param getmset_sent	Has start_match() or start_single_match()
+     *				been called?
+     */
+    void abandon_match(bool getmset_sent) {
+	db->abandon_match(getmset_sent);
+    }
+
+    /// Return the number of documents in the remote database.
+    Xapian::doccount get_doccount() const {
+	return db->get_doccount();
     }
 
     typedef Xapian::Internal::opt_intrusive_ptr<Xapian::MatchSpy> opt_ptr_spy;
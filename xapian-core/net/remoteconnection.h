@@ -146,6 +146,9 @@ class RemoteConnection {
     /** Return the underlying fd this remote connection reads from. */
     int get_read_fd() const { return fdin; }
 
+    /** Has input been read from fdin which hasn't been returned yet? */
+    bool input_buffered() const { return !buffer.empty(); }
+
     /** Check what the next message type is.
      *
      *  This must not be called after a call to get_message_chunked() until
@@ -59,8 +59,12 @@
 // 45: pre-1.5.0 Remote support for sorters
 // 46: pre-1.5.0 Drop unused fields; front-code term names in serialised stats
 // 46.1: 1.5.0 MSG_REQUESTDOCUMENT added
-#define XAPIAN_REMOTE_PROTOCOL_MAJOR_VERSION 46
-#define XAPIAN_REMOTE_PROTOCOL_MINOR_VERSION 1
+// 47: 1.5.0 MSG_CANCELMATCH added; MSG_GETMSET and MSet serialisation pass
+//     cancelled flag
+// 47.1: 1.5.0 Global stats in MSG_GETMSET can be omitted
+// 47.2: 1.5.0 MSG_POSTLISTCHUNK added
+#define XAPIAN_REMOTE_PROTOCOL_MAJOR_VERSION 47
+#define XAPIAN_REMOTE_PROTOCOL_MINOR_VERSION 2
 
 /** Message types (client -> server).
  *
@@ -108,6 +112,8 @@ enum message_type {
     MSG_REMOVESYNONYM,		// Remove a synonym
     MSG_CLEARSYNONYMS,		// Clear synonyms for a term
     MSG_REQUESTDOCUMENT,        // Request a document (pre-read hint)
+    MSG_CANCELMATCH,		// Stop the current match early
+    MSG_POSTLISTCHUNK,		// Get part of a PostList
     MSG_MAX
 };
 
@@ -32,6 +32,7 @@
 #include "xapian/valueiterator.h"
 
 #include <signal.h>
+#include <atomic>
 #include <cerrno>
 #include <cstdlib>
 #include <memory>
@@ -199,6 +200,9 @@ RemoteServer::run()
 		case MSG_POSTLIST:
 		    msg_postlist(message);
 		    continue;
+		case MSG_POSTLISTCHUNK:
+		    msg_postlistchunk(message);
+		    continue;
 		case MSG_REOPEN:
 		    msg_reopen(message);
 		    continue;
@@ -235,6 +239,15 @@ RemoteServer::run()
 		case MSG_SETMETADATA:
 		    msg_setmetadata(message);
 		    continue;
+		case MSG_CANCELMATCH:
+		    // The match finished before this arrived, so there's
+		    // nothing to do.
+		    continue;
+		case MSG_GETMSET:
+		    // A client searching only this database sends MSG_GETMSET
+		    // without waiting for REPLY_STATS.  If MSG_QUERY failed,
+		    // the client has been sent the exception, and we get here.
+		    continue;
 		case MSG_REQUESTDOCUMENT:
 		    msg_requestdocument(message);
 		    continue;
@@ -278,7 +291,6 @@ RemoteServer::run()
 		    msg_clearsynonyms(message);
 		    continue;
 		default: {
-		    // MSG_GETMSET - used during a conversation.
 		    // MSG_SHUTDOWN - handled by get_message().
 		    string errmsg("Unexpected message type ");
 		    errmsg += str(type);
@@ -446,6 +458,41 @@ RemoteServer::msg_postlist(const string &message)
     send_message(REPLY_POSTLIST, reply);
 }
 
+void
+RemoteServer::msg_postlistchunk(const string &message)
+{
+    const char *p = message.data();
+    const char *p_end = p + message.size();
+    Xapian::docid lastdocid;
+    Xapian::doccount max_postings;
+    if (!unpack_uint(&p, p_end, &lastdocid) ||
+	!unpack_uint(&p, p_end, &max_postings)) {
+	unpack_throw_serialisation_error(p);
+    }
+    string term(p, p_end - p);
+
+    Xapian::doccount termfreq = db->get_termfreq(term);
+    string reply;
+    pack_uint_last(reply, termfreq);
+    send_message(REPLY_POSTLISTHEADER, reply);
+
+    reply.resize(0);
+    Xapian::PostingIterator i = db->postlist_begin(term);
+    if (lastdocid != 0)
+	i.skip_to(lastdocid + 1);
+    while (max_postings && i != db->postlist_end(term)) {
+	Xapian::docid newdocid = *i;
+	pack_uint(reply, newdocid - lastdocid - 1);
+	pack_uint(reply, i.get_wdf());
+
+	lastdocid = newdocid;
+	--max_postings;
+	++i;
+    }
+
+    send_message(REPLY_POSTLIST, reply);
+}
+
 void
 RemoteServer::msg_writeaccess(const string & msg)
 {
@@ -610,16 +657,17 @@ RemoteServer::msg_query(const string &message_in)
 						   reg)->release());
     }
 
-    Xapian::Weight::Internal local_stats;
+    unique_ptr<Xapian::Weight::Internal> local_stats;
+    local_stats.reset(new Xapian::Weight::Internal);
     Matcher matcher(*db,
-		    query, qlen, &rset, local_stats, *wt,
+		    query, qlen, &rset, *local_stats, *wt,
 		    false,
 		    collapse_key, collapse_max,
 		    percent_threshold, weight_threshold,
 		    order, sort_key, sort_by, sort_value_forward, time_limit,
-		    matchspies);
+		    0.0, matchspies);
 
-    send_message(REPLY_STATS, serialise_stats(local_stats));
+    send_message(REPLY_STATS, serialise_stats(*local_stats));
 
     string message;
     get_message(active_timeout, message, MSG_GETMSET);
@@ -629,10 +677,12 @@ RemoteServer::msg_query(const string &message_in)
     Xapian::termcount first;
     Xapian::termcount maxitems;
     Xapian::termcount check_at_least;
+    bool cancelled;
     string sorter_type;
     if (!unpack_uint(&p, p_end, &first) ||
 	!unpack_uint(&p, p_end, &maxitems) ||
 	!unpack_uint(&p, p_end, &check_at_least) ||
+	!unpack_bool(&p, p_end, &cancelled) ||
 	!unpack_string(&p, p_end, sorter_type)) {
 	throw Xapian::NetworkError("Bad MSG_GETMSET");
     }
@@ -651,16 +701,28 @@ RemoteServer::msg_query(const string &message_in)
 	sorter.reset(sorterclass->unserialise(serialised_sorter, reg));
     }
 
-    unique_ptr<Xapian::Weight::Internal> total_stats(new Xapian::Weight::Internal);
-    unserialise_stats(p, p_end, *total_stats);
+    unique_ptr<Xapian::Weight::Internal> total_stats;
+    if (p == p_end) {
+	// The client has told us we're the only shard, so our stats are the
+	// global stats.
+	total_stats = std::move(local_stats);
+    } else {
+	total_stats.reset(new Xapian::Weight::Internal);
+	unserialise_stats(p, p_end, *total_stats);
+    }
 
+    // The client sends MSG_CANCELMATCH if it wants us to stop the match
+    // early.  It doesn't send anything else until we reply, so any input
+    // means the match has been cancelled.
+    atomic<bool> cancel_flag(cancelled || input_buffered());
     Xapian::MSet mset = matcher.get_mset(first, maxitems, check_at_least,
 					 *total_stats, *wt, 0, sorter.get(),
 					 collapse_key, collapse_max,
 					 percent_threshold, weight_threshold,
 					 order,
 					 sort_key, sort_by, sort_value_forward,
-					 time_limit, matchspies);
+					 time_limit, &cancel_flag,
+					 get_read_fd(), matchspies);
     // FIXME: The local side already has these stats, except for the maxpart
     // information.
     mset.internal->set_stats(total_stats.release());
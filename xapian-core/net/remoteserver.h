@@ -134,6 +134,10 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
     XAPIAN_VISIBILITY_INTERNAL
     void msg_postlist(const std::string & message);
 
+    // get part of a postlist
+    XAPIAN_VISIBILITY_INTERNAL
+    void msg_postlistchunk(const std::string & message);
+
     // get positionlist
     XAPIAN_VISIBILITY_INTERNAL
     void msg_positionlist(const std::string &message);
@@ -49,6 +49,22 @@ void
 TermGenerator::set_stemmer(const Xapian::Stem & stemmer)
 {
     internal->stemmer = stemmer;
+    if (internal->stemmer_cache_size)
+	internal->stemmer.set_cache_size(internal->stemmer_cache_size);
+}
+
+const Xapian::Stem &
+TermGenerator::get_stemmer() const
+{
+    return internal->stemmer;
+}
+
+void
+TermGenerator::set_stemmer_cache_size(size_t size)
+{
+    internal->stemmer_cache_size = size;
+    if (size)
+	internal->stemmer.set_cache_size(size);
 }
 
 void
@@ -24,6 +24,7 @@
 
 #include "api/msetinternal.h"
 #include "api/queryinternal.h"
+#include "backends/documentinternal.h"
 
 #include <xapian/document.h>
 #include <xapian/queryparser.h>
@@ -60,6 +61,47 @@ check_wordchar(unsigned ch)
     return 0;
 }
 
+/** Test if an ASCII character is a word character.
+ *
+ *  This gives the same answer as Unicode::is_wordchar(), but without needing
+ *  to look up the character's category.
+ */
+static inline bool
+is_ascii_wordchar(char ch)
+{
+    return C_isalnum(ch) || ch == '_';
+}
+
+/** Advance to the next word character.
+ *
+ *  @return	The word character, converted to lower case, or 0 if the end
+ *		of the text was reached first.
+ */
+static inline unsigned
+skip_to_wordchar(Utf8Iterator& itor)
+{
+    while (itor != Utf8Iterator()) {
+	// Skip any ASCII spaces and punctuation without decoding each one.
+	const char* p = itor.raw();
+	const char* end = p + itor.left();
+	const char* q = p;
+	while (q != end &&
+	       static_cast<unsigned char>(*q) < 0x80 &&
+	       !is_ascii_wordchar(*q)) {
+	    ++q;
+	}
+	if (q == end) {
+	    itor = Utf8Iterator();
+	    break;
+	}
+	if (q != p) itor.assign(q, end - q);
+	unsigned ch = check_wordchar(*itor);
+	if (ch) return ch;
+	++itor;
+    }
+    return 0;
+}
+
 static inline bool
 should_stem(const std::string & term)
 {
@@ -185,13 +227,8 @@ parse_terms(Utf8Iterator itor, unsigned break_flags, bool with_positions,
 {
     while (true) {
 	// Advance to the start of the next term.
-	unsigned ch;
-	while (true) {
-	    if (itor == Utf8Iterator()) return;
-	    ch = check_wordchar(*itor);
-	    if (ch) break;
-	    ++itor;
-	}
+	unsigned ch = skip_to_wordchar(itor);
+	if (!ch) return;
 
 	string term;
 	// Look for initials separated by '.' (e.g. P.T.O., U.N.C.L.E).
@@ -219,18 +256,30 @@ parse_terms(Utf8Iterator itor, unsigned break_flags, bool with_positions,
 	    if (break_flags && is_unbroken_wordchar(*itor)) {
 		if (!break_words(itor, break_flags, with_positions, action))
 		    return;
-		while (true) {
-		    if (itor == Utf8Iterator()) return;
-		    ch = check_wordchar(*itor);
-		    if (ch) break;
-		    ++itor;
-		}
+		ch = skip_to_wordchar(itor);
+		if (!ch) return;
 		continue;
 	    }
 	    unsigned prevch;
 	    do {
 		Unicode::append_utf8(term, ch);
 		prevch = ch;
+		const char* p = itor.raw();
+		if (static_cast<unsigned char>(*p) < 0x80) {
+		    // Most text is largely ASCII, so copy any run of ASCII word
+		    // characters which follows without decoding each one.
+		    // Then ++itor below moves past the last of them.
+		    const char* end = p + itor.left();
+		    const char* q = p + 1;
+		    while (q != end && is_ascii_wordchar(*q)) {
+			term += C_tolower(*q);
+			++q;
+		    }
+		    if (q != p + 1) {
+			prevch = static_cast<unsigned char>(C_tolower(q[-1]));
+			itor.assign(q - 1, end - (q - 1));
+		    }
+		}
 		if (++itor == Utf8Iterator() ||
 		    (break_flags && is_unbroken_script(*itor)))
 		    goto endofterm;
@@ -278,6 +327,91 @@ endofterm:
     }
 }
 
+/** Limit on the number of distinct terms remembered by TermGenerator.
+ *
+ *  Once this is exceeded, we forget them all at the start of the next call to
+ *  index_text(), which stops a long run of documents with many unique terms
+ *  from using an unbounded amount of memory.
+ */
+static constexpr size_t MAX_PENDING_TERM_IDS = 100000;
+
+void
+TermGenerator::Internal::add_pending(const string& term, termpos pos)
+{
+    auto r = pending_term_ids.try_emplace(term,
+					  unsigned(pending_term_names.size()));
+    if (r.second) {
+	pending_term_names.push_back(&r.first->first);
+	uint64_t key = 0;
+	for (size_t i = 0; i != 8; ++i) {
+	    key <<= 8;
+	    if (i < term.size()) key |= static_cast<unsigned char>(term[i]);
+	}
+	pending_term_keys.push_back(key);
+    }
+    pending_terms.push_back(PendingTerm{r.first->second, pos});
+}
+
+void
+TermGenerator::Internal::flush_pending(termcount wdf_inc)
+{
+    if (pending_terms.empty()) return;
+
+    // Gather the entries for each term.
+    if (group_of_id.size() < pending_term_names.size())
+	group_of_id.resize(pending_term_names.size(), NO_GROUP);
+    pending_groups.clear();
+    for (auto& e : pending_terms) {
+	unsigned g = group_of_id[e.term_id];
+	if (g == NO_GROUP) {
+	    g = unsigned(pending_groups.size());
+	    group_of_id[e.term_id] = g;
+	    pending_groups.push_back(PendingGroup{e.term_id, 0, 0, 0});
+	}
+	if (e.pos) {
+	    ++pending_groups[g].end;
+	} else {
+	    ++pending_groups[g].extra;
+	}
+    }
+    unsigned offset = 0;
+    for (auto& group : pending_groups) {
+	group.begin = offset;
+	offset += group.end;
+	group.end = group.begin;
+    }
+    // The positions were generated in ascending order, so stay sorted.
+    pos_buf.resize(offset);
+    for (auto& e : pending_terms) {
+	if (e.pos) {
+	    auto& group = pending_groups[group_of_id[e.term_id]];
+	    pos_buf[group.end++] = e.pos;
+	}
+    }
+    for (auto& group : pending_groups) {
+	group_of_id[group.term_id] = NO_GROUP;
+    }
+
+    // Add the terms in ascending order.
+    sort(pending_groups.begin(), pending_groups.end(),
+	 [this](const PendingGroup& x, const PendingGroup& y) {
+	     auto kx = pending_term_keys[x.term_id];
+	     auto ky = pending_term_keys[y.term_id];
+	     if (kx != ky) return kx < ky;
+	     return *pending_term_names[x.term_id] <
+		    *pending_term_names[y.term_id];
+	 });
+    auto& doc_internal = *doc.internal;
+    auto hint = doc_internal.start_add_postings();
+    for (auto& group : pending_groups) {
+	doc_internal.add_postings(hint, *pending_term_names[group.term_id],
+				  pos_buf.data() + group.begin,
+				  pos_buf.data() + group.end,
+				  wdf_inc, group.extra * wdf_inc);
+    }
+    pending_terms.clear();
+}
+
 void
 TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 				    const string & prefix, bool with_positions)
@@ -300,8 +434,19 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 	current_stop_mode = stop_mode;
     }
 
+    pending_terms.clear();
+    if (pending_term_ids.size() > MAX_PENDING_TERM_IDS) {
+	pending_term_ids.clear();
+	pending_term_names.clear();
+	pending_term_keys.clear();
+    }
+
+    // Rather than adding each term to doc as we go, we note them and add them
+    // all at the end, which avoids looking up and updating doc's term map for
+    // every word, and building a new string for each term when the words are
+    // ones we've seen before.
     parse_terms(itor, break_flags, with_positions,
-	[=
+	[=, &prefix
 #if __cplusplus >= 201907L
 // C++20 no longer supports implicit `this` in lambdas but older C++ versions
 // don't allow `this` here.
@@ -318,11 +463,13 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 	    if (strategy == TermGenerator::STEM_SOME ||
 		strategy == TermGenerator::STEM_NONE ||
 		strategy == TermGenerator::STEM_SOME_FULL_POS) {
-		if (positional) {
-		    doc.add_posting(prefix + term, ++cur_pos, wdf_inc);
-		} else {
-		    doc.add_term(prefix + term, wdf_inc);
+		const string* t = &term;
+		if (!prefix.empty()) {
+		    term_buf.assign(prefix);
+		    term_buf += term;
+		    t = &term_buf;
 		}
+		add_pending(*t, positional ? ++cur_pos : 0);
 	    }
 
 	    // MSVC seems to need "this->" on member variables in this
@@ -347,20 +494,22 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 	    // Add stemmed form without positional information.
 	    const string& stem = stemmer(term);
 	    if (rare(stem.empty())) return true;
-	    string stemmed_term;
+	    term_buf.clear();
 	    if (strategy != TermGenerator::STEM_ALL) {
-		stemmed_term += "Z";
+		term_buf += 'Z';
 	    }
-	    stemmed_term += prefix;
-	    stemmed_term += stem;
+	    term_buf += prefix;
+	    term_buf += stem;
 	    if (strategy != TermGenerator::STEM_SOME && positional) {
 		if (strategy != TermGenerator::STEM_SOME_FULL_POS) ++cur_pos;
-		doc.add_posting(stemmed_term, cur_pos, wdf_inc);
+		add_pending(term_buf, cur_pos);
 	    } else {
-		doc.add_term(stemmed_term, wdf_inc);
+		add_pending(term_buf, 0);
 	    }
 	    return true;
 	});
+
+    flush_pending(wdf_inc);
 }
 
 struct Sniplet {
@@ -28,6 +28,11 @@
 #include <xapian/queryparser.h> // For Xapian::Stopper
 #include <xapian/stem.h>
 
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace Xapian {
 
 class Stopper;
@@ -44,6 +49,84 @@ class TermGenerator::Internal : public Xapian::Internal::intrusive_base {
     unsigned max_word_length = 64;
     WritableDatabase db;
 
+    /// Size of cache to use for stemmer, or 0 to use its own.
+    size_t stemmer_cache_size = 0;
+
+    /** A term generated by index_text() which hasn't been added to doc yet.
+     *
+     *  Rather than updating doc's term map for each word, index_text()
+     *  appends one of these to a flat buffer and then adds all the terms to
+     *  doc in one pass at the end, in ascending order so that the map can be
+     *  built without searching it.
+     */
+    struct PendingTerm {
+	/// Index of the term in pending_term_names.
+	unsigned term_id;
+
+	/** The position, or 0 for a term without a position.
+	 *
+	 *  Positions generated by index_text() always start from 1.
+	 */
+	termpos pos;
+    };
+
+    /// Summary of the entries in pending_terms for one term.
+    struct PendingGroup {
+	/// Index of the term in pending_term_names.
+	unsigned term_id;
+
+	/// Offset of the term's first position in pos_buf.
+	unsigned begin;
+
+	/// Offset after the term's last position in pos_buf.
+	unsigned end;
+
+	/// The number of entries without a position.
+	termcount extra;
+    };
+
+    /// Value in group_of_id for a term without an entry in pending_groups.
+    static constexpr unsigned NO_GROUP = unsigned(-1);
+
+    /** Terms which have been generated, mapped to an id.
+     *
+     *  This is kept between calls to index_text() (up to a size limit), so
+     *  most words only need a hash lookup here, and a new string is only
+     *  created for a term the first time it is added to a document.
+     */
+    std::unordered_map<std::string, unsigned> pending_term_ids;
+
+    /// The term name for each id in pending_term_ids.
+    std::vector<const std::string*> pending_term_names;
+
+    /** Sort key for each id in pending_term_ids.
+     *
+     *  This is the first 8 bytes of the term as a big-endian integer, which
+     *  allows most pairs of terms to be ordered without comparing strings.
+     */
+    std::vector<std::uint64_t> pending_term_keys;
+
+    /// Terms generated by the current call to index_text().
+    std::vector<PendingTerm> pending_terms;
+
+    /// Groups of pending_terms, reused to avoid reallocating.
+    std::vector<PendingGroup> pending_groups;
+
+    /// Index in pending_groups for each term id, or NO_GROUP.
+    std::vector<unsigned> group_of_id;
+
+    /// Buffer for building terms, reused to avoid reallocating.
+    std::string term_buf;
+
+    /// Buffer for positions, reused to avoid reallocating.
+    std::vector<termpos> pos_buf;
+
+    /// Note a term to add to doc, with position @a pos (0 for none).
+    void add_pending(const std::string& term, termpos pos);
+
+    /// Add pending_terms to doc.
+    void flush_pending(termcount wdf_inc);
+
   public:
     Internal() { }
 
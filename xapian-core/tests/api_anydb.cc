@@ -2128,6 +2128,63 @@ DEFINE_TESTCASE(alldocspl2, writable) {
     TEST(i == end);
 }
 
+static void
+make_postlistchunks1_db(Xapian::WritableDatabase& db, const string&)
+{
+    // Use sparse docids so the alldocs postlist isn't contiguous.
+    for (Xapian::docid did = 3; did <= 9000; did += 3) {
+	Xapian::Document doc;
+	doc.add_term("all", did % 5 + 1);
+	if (did % 2 == 0) doc.add_term("even");
+	db.replace_document(did, doc);
+    }
+}
+
+/// Test iterating and skipping through postlists longer than one chunk.
+DEFINE_TESTCASE(postlistchunks1, backend) {
+    Xapian::Database db = get_database("postlistchunks1",
+				       make_postlistchunks1_db);
+    TEST_EQUAL(db.get_termfreq("all"), 3000);
+
+    Xapian::docid expected = 3;
+    for (auto i = db.postlist_begin("all"); i != db.postlist_end("all"); ++i) {
+	TEST_EQUAL(*i, expected);
+	TEST_EQUAL(i.get_wdf(), expected % 5 + 1);
+	expected += 3;
+    }
+    TEST_EQUAL(expected, 9003);
+
+    expected = 3;
+    for (auto i = db.postlist_begin(""); i != db.postlist_end(""); ++i) {
+	TEST_EQUAL(*i, expected);
+	expected += 3;
+    }
+    TEST_EQUAL(expected, 9003);
+
+    Xapian::PostingIterator i = db.postlist_begin("even");
+    TEST_EQUAL(*i, 6);
+    // Skip within the postings already read.
+    i.skip_to(100);
+    TEST_EQUAL(*i, 102);
+    // Skip past them.
+    i.skip_to(7000);
+    TEST_EQUAL(*i, 7002);
+    ++i;
+    TEST_EQUAL(*i, 7008);
+    // Skipping backwards is a no-op.
+    i.skip_to(10);
+    TEST_EQUAL(*i, 7008);
+    i.skip_to(8999);
+    TEST_EQUAL(*i, 9000);
+    ++i;
+    TEST(i == db.postlist_end("even"));
+
+    // Skip straight past the end before reading anything.
+    i = db.postlist_begin("all");
+    i.skip_to(9001);
+    TEST(i == db.postlist_end("all"));
+}
+
 // Feature test for Query::OP_SCALE_WEIGHT.
 DEFINE_TESTCASE(scaleweight1, backend) {
     Xapian::Database db(get_database("apitest_phrase"));
@@ -30,6 +30,7 @@
 #include "errno_to_string.h"
 #include "filetests.h"
 #include "net/resolver.h"
+#include "setenv.h"
 #include "str.h"
 #include "socket_utils.h"
 #include "testrunner.h"
@@ -638,6 +639,52 @@ DEFINE_TESTCASE(databasemodified1, writable && !inmemory && !multi) {
     }
 }
 
+struct unset_keep_revisions_helper_ {
+    ~unset_keep_revisions_helper_() { setenv("XAPIAN_KEEP_REVISIONS", "", 1); }
+};
+
+/// Test XAPIAN_KEEP_REVISIONS avoids the DatabaseModifiedError above.
+DEFINE_TESTCASE(keeprevisions1, glass) {
+    Xapian::WritableDatabase db(get_writable_database());
+    Xapian::Document doc;
+    doc.set_data("cargo");
+    doc.add_term("abc");
+    doc.add_term("def");
+    doc.add_term("ghi");
+    const int N = 500;
+    for (int i = 0; i < N; ++i) {
+	db.add_document(doc);
+    }
+    db.commit();
+
+    unset_keep_revisions_helper_ unset_afterwards;
+    setenv("XAPIAN_KEEP_REVISIONS", "2", 1);
+
+    Xapian::Database rodb(get_writable_database_as_database());
+    db.add_document(doc);
+    db.commit();
+
+    db.add_document(doc);
+    db.commit();
+
+    db.add_document(doc);
+    TEST_EQUAL(*rodb.termlist_begin(N - 1), "abc");
+    TEST_EQUAL(rodb.get_doccount(), N);
+
+    Xapian::Enquire enq(rodb);
+    enq.set_query(Xapian::Query("abc"));
+    Xapian::MSet mset = enq.get_mset(0, 10);
+    TEST_EQUAL(mset.get_matches_estimated(), N);
+
+    db.commit();
+    TEST(rodb.reopen());
+    TEST_EQUAL(rodb.get_doccount(), N + 3);
+
+    setenv("XAPIAN_KEEP_REVISIONS", "x", 1);
+    db.add_document(doc);
+    TEST_EXCEPTION(Xapian::InvalidArgumentError, db.commit());
+}
+
 /// Regression test for bug#462 fixed in 1.0.19 and 1.1.5.
 DEFINE_TESTCASE(qpmemoryleak1, writable && !inmemory) {
     // Inmemory never throws DatabaseModifiedError.
@@ -2083,3 +2130,37 @@ DEFINE_TESTCASE(corruptglass1, glass) {
 		       Xapian::Database::check(db_path));
     }
 }
+
+/// Check term statistics are updated when a reader opens a new revision.
+DEFINE_TESTCASE(termstats1, glass) {
+    Xapian::WritableDatabase wdb = get_writable_database("apitest_simpledata");
+    wdb.commit();
+    Xapian::Database db = get_writable_database_as_database();
+    Xapian::doccount termfreq = db.get_termfreq("this");
+    Xapian::termcount collfreq = db.get_collection_freq("this");
+    TEST_REL(termfreq, >, 0);
+    TEST_EQUAL(db.get_termfreq("this"), termfreq);
+    TEST_EQUAL(db.get_termfreq("nosuchterm"), 0);
+    TEST_EQUAL(db.get_wdf_upper_bound("nosuchterm"), 0);
+
+    Xapian::Document doc;
+    doc.add_term("this", 100);
+    doc.add_term("nosuchterm");
+    wdb.add_document(doc);
+    wdb.commit();
+
+    // Until reopen() is called, db is still reading the old revision.
+    TEST_EQUAL(db.get_termfreq("this"), termfreq);
+    TEST_EQUAL(db.get_termfreq("nosuchterm"), 0);
+
+    TEST(db.reopen());
+    TEST_EQUAL(db.get_termfreq("this"), termfreq + 1);
+    TEST_EQUAL(db.get_collection_freq("this"), collfreq + 100);
+    TEST_REL(db.get_wdf_upper_bound("this"), >=, 100);
+    TEST_EQUAL(db.get_termfreq("nosuchterm"), 1);
+    TEST_EQUAL(db.get_wdf_upper_bound("nosuchterm"), 1);
+
+    // Cached statistics mustn't hide that the database has been closed.
+    db.close();
+    TEST_EXCEPTION(Xapian::DatabaseClosedError, db.get_termfreq("this"));
+}
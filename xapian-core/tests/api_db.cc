@@ -865,6 +865,91 @@ DEFINE_TESTCASE(keepalive1, remote) {
 			      enquire.get_mset(0, 10));
 }
 
+/// Check that remote shards which miss the deadline are left out.
+DEFINE_TESTCASE(remotedeadline1, remote) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::doccount n_shards = db.size();
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("paragraph"));
+    Xapian::MSet full = enquire.get_mset(0, 10);
+    TEST_EQUAL(full.get_missing_shard_count(), 0);
+    TEST_EQUAL(full.size(), 5);
+
+    // The deadline is too small to meet, so all the remote shards should be
+    // left out, but any local shards should still be searched.
+    enquire.set_remote_deadline(1e-9);
+    for (int i = 0; i != 2; ++i) {
+	// On the second time round, the late replies from the first search
+	// may not have arrived yet.
+	Xapian::MSet mset = enquire.get_mset(0, 10);
+	Xapian::doccount missing = mset.get_missing_shard_count();
+	TEST_REL(missing, >, 0);
+	TEST(!mset.was_shard_missing(n_shards));
+	for (Xapian::docid did : mset) {
+	    TEST(!mset.was_shard_missing((did - 1) % n_shards));
+	}
+	if (missing == n_shards) {
+	    TEST_EQUAL(mset.size(), 0);
+	    TEST_EQUAL(mset.get_matches_lower_bound(), 0);
+	    TEST_EQUAL(mset.get_matches_upper_bound(), db.get_doccount());
+	}
+	TEST_REL(mset.get_matches_lower_bound(), <=,
+		 full.get_matches_lower_bound());
+	TEST_REL(mset.get_matches_upper_bound(), >=,
+		 full.get_matches_upper_bound());
+    }
+
+    // The requested first should be reported even if no shards replied
+    // (with a single remote shard this takes a different code path).
+    Xapian::MSet deep = enquire.get_mset(2, 10);
+    TEST_REL(deep.get_missing_shard_count(), >, 0);
+    TEST_EQUAL(deep.get_firstitem(), 2);
+    if (deep.get_missing_shard_count() == n_shards) {
+	TEST_EQUAL(deep.size(), 0);
+    }
+
+    // The shards should all reply in time for this deadline.
+    enquire.set_remote_deadline(60.0);
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset.get_missing_shard_count(), 0);
+    TEST(mset_range_is_same(mset, 0, full, 0, full.size()));
+    TEST_EQUAL(mset.get_matches_upper_bound(), full.get_matches_upper_bound());
+
+    enquire.set_remote_deadline(0.0);
+    mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset.get_missing_shard_count(), 0);
+    TEST(mset_range_is_same(mset, 0, full, 0, full.size()));
+    TEST_EQUAL(db.get_termfreq("paragraph"), 5);
+}
+
+/// Check the estimates when remote shards miss the deadline.
+DEFINE_TESTCASE(remotedeadline2, remote && !multi) {
+    Xapian::Database remote = get_database("apitest_simpledata");
+    Xapian::WritableDatabase local(string(), Xapian::DB_BACKEND_INMEMORY);
+    Xapian::Document doc;
+    doc.add_term("paragraph");
+    local.add_document(doc);
+    local.add_document(Xapian::Document());
+    Xapian::Database db;
+    db.add_database(remote);
+    db.add_database(local);
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("paragraph"));
+    enquire.set_remote_deadline(1e-9);
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 1);
+    TEST_EQUAL(*mset.begin(), 2);
+    TEST_EQUAL(mset.get_missing_shard_count(), 1);
+    TEST(mset.was_shard_missing(0));
+    TEST(!mset.was_shard_missing(1));
+    TEST_EQUAL(mset.get_matches_lower_bound(), 1);
+    TEST_EQUAL(mset.get_matches_upper_bound(), remote.get_doccount() + 1);
+    // Half the documents searched matched, so half of the rest are assumed
+    // to.
+    TEST_EQUAL(mset.get_matches_estimated(), (remote.get_doccount() + 2) / 2);
+}
+
 // test that iterating through all terms in a database works.
 DEFINE_TESTCASE(allterms1, backend) {
     Xapian::Database db(get_database("apitest_allterms"));
@@ -1775,6 +1860,24 @@ DEFINE_TESTCASE(userweight1, backend && !remote) {
     }
 }
 
+/** Check a remote search fails cleanly for an unregistered weighting scheme.
+ *
+ *  The client may ask for the MSet without waiting for the remote's stats,
+ *  so this checks that the connection is still usable afterwards.
+ */
+DEFINE_TESTCASE(userweight2, remote) {
+    Xapian::Database db(get_database("apitest_simpledata"));
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("paragraph"));
+    enquire.set_weighting_scheme(MyWeight());
+    TEST_EXCEPTION(Xapian::InvalidArgumentError, enquire.get_mset(0, 10));
+
+    enquire.set_weighting_scheme(Xapian::BM25Weight());
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 5);
+    TEST_EQUAL(db.get_termfreq("paragraph"), 5);
+}
+
 // tests MatchAll queries
 // This is a regression test, which failed with assertion failures in
 // revision 9094.  Also check that the results aren't ranked by relevance
@@ -86,3 +86,26 @@ DEFINE_TESTCASE(lcdclusterer2, backend)
 	TEST(d.size() != 0);
     }
 }
+
+/// Check the documents returned and that a Diversify object can be reused.
+DEFINE_TESTCASE(diversify2, backend)
+{
+    Xapian::Database db = get_database("apitest_diversify");
+    Xapian::Enquire enq(db);
+    enq.set_query(Xapian::Query("java"));
+    Xapian::MSet matches = enq.get_mset(0, 10);
+    TEST_EQUAL(matches.size(), 7);
+
+    unsigned int k = 4, r = 2;
+    Xapian::Diversify d(k, r);
+    for (int repeat = 0; repeat < 2; ++repeat) {
+	Xapian::DocumentSet dset = d.get_dmset(matches);
+	TEST_EQUAL(dset.size(), matches.size());
+	// For this data no swaps improve on the initial top k, and the rest
+	// of the documents should follow in MSet order.
+	for (Xapian::doccount i = 0; i < dset.size(); ++i) {
+	    Xapian::Document doc = matches[i].get_document();
+	    TEST_EQUAL(dset[i].get_docid(), doc.get_docid());
+	}
+    }
+}
@@ -0,0 +1,214 @@
+/** @file
+ * @brief tests of Xapian::MSetCache
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "api_msetcache.h"
+
+#include <xapian.h>
+
+#include "apitest.h"
+#include "testsuite.h"
+#include "testutils.h"
+
+using namespace std;
+
+/// Check a result set from a cache against one from a search.
+static void
+check_same_results(const Xapian::MSet& mset, const Xapian::MSet& expected)
+{
+    TEST_EQUAL(mset.get_firstitem(), expected.get_firstitem());
+    TEST_EQUAL(mset.size(), expected.size());
+    TEST(mset_range_is_same(mset, 0, expected, 0, mset.size()));
+    TEST_EQUAL(mset.get_max_attained(), expected.get_max_attained());
+    for (Xapian::doccount i = 0; i != mset.size(); ++i) {
+	TEST_EQUAL(mset[i].get_percent(), expected[i].get_percent());
+	TEST_EQUAL(mset[i].get_document().get_data(),
+		   expected[i].get_document().get_data());
+    }
+}
+
+/// Check results with a cache match those without for any backend.
+DEFINE_TESTCASE(msetcache1, backend) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Enquire enquire(db);
+    Xapian::Enquire cached_enquire(db);
+    Xapian::MSetCache cache(1024 * 1024);
+    cached_enquire.set_mset_cache(cache);
+
+    Xapian::Query query(Xapian::Query::OP_OR,
+			Xapian::Query("this"), Xapian::Query("word"));
+    enquire.set_query(query);
+    cached_enquire.set_query(query);
+
+    for (int repeat = 0; repeat != 2; ++repeat) {
+	for (Xapian::doccount first = 0; first != 8; ++first) {
+	    for (Xapian::doccount maxitems = 0; maxitems != 4; ++maxitems) {
+		check_same_results(cached_enquire.get_mset(first, maxitems),
+				   enquire.get_mset(first, maxitems));
+	    }
+	}
+    }
+
+    // Check a different sort order isn't answered from the cache.
+    enquire.set_sort_by_value(1, true);
+    cached_enquire.set_sort_by_value(1, true);
+    check_same_results(cached_enquire.get_mset(0, 10),
+		       enquire.get_mset(0, 10));
+}
+
+/// Check which searches are answered from the cache.
+DEFINE_TESTCASE(msetcache2, glass || honey) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Enquire enquire(db);
+    Xapian::MSetCache cache(1024 * 1024);
+    enquire.set_mset_cache(cache);
+    enquire.set_query(Xapian::Query("this"));
+
+    Xapian::MSet mset = enquire.get_mset(0, 2);
+    TEST_EQUAL(cache.get_hits(), 0);
+    TEST_EQUAL(cache.get_misses(), 1);
+    TEST_EQUAL(cache.get_entry_count(), 1);
+    TEST_REL(cache.get_size(), >, 0);
+
+    // The same search again.
+    check_same_results(enquire.get_mset(0, 2), mset);
+    TEST_EQUAL(cache.get_hits(), 1);
+    // A page within the cached results.
+    enquire.get_mset(1, 1);
+    TEST_EQUAL(cache.get_hits(), 2);
+    // A later page needs a new search...
+    mset = enquire.get_mset(2, 2);
+    TEST_EQUAL(cache.get_misses(), 2);
+    // ...which replaces the old entry and can answer all the earlier pages.
+    TEST_EQUAL(cache.get_entry_count(), 1);
+    check_same_results(enquire.get_mset(2, 2), mset);
+    enquire.get_mset(0, 2);
+    TEST_EQUAL(cache.get_hits(), 4);
+
+    // A higher checkatleast needs a new search.
+    enquire.get_mset(0, 2, db.get_doccount());
+    TEST_EQUAL(cache.get_misses(), 3);
+
+    // If the search found all the matches, any page can be answered.
+    enquire.get_mset(0, 100);
+    TEST_EQUAL(cache.get_misses(), 4);
+    enquire.get_mset(50, 200);
+    TEST_EQUAL(cache.get_hits(), 5);
+
+    // Another Enquire object sharing the cache can use its results.
+    Xapian::Enquire enquire2(get_database("apitest_simpledata"));
+    enquire2.set_mset_cache(cache);
+    enquire2.set_query(Xapian::Query("this"));
+    enquire2.get_mset(0, 10);
+    TEST_EQUAL(cache.get_hits(), 6);
+
+    // A different weighting scheme is a different search.
+    enquire2.set_weighting_scheme(Xapian::BoolWeight());
+    enquire2.get_mset(0, 10);
+    TEST_EQUAL(cache.get_misses(), 5);
+    TEST_EQUAL(cache.get_entry_count(), 2);
+
+    // Searches using a MatchDecider can't be cached.
+    Xapian::ValueSetMatchDecider decider(0, true);
+    enquire2.get_mset(0, 10, 0, NULL, &decider);
+    TEST_EQUAL(cache.get_hits(), 6);
+    TEST_EQUAL(cache.get_misses(), 5);
+
+    enquire2.clear_mset_cache();
+    enquire2.get_mset(0, 10);
+    TEST_EQUAL(cache.get_hits(), 6);
+
+    cache.clear();
+    TEST_EQUAL(cache.get_entry_count(), 0);
+    TEST_EQUAL(cache.get_size(), 0);
+    enquire.get_mset(0, 10);
+    TEST_EQUAL(cache.get_misses(), 6);
+}
+
+/// Check the memory limit is respected.
+DEFINE_TESTCASE(msetcache3, glass) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("this"));
+
+    // Find how much memory one entry needs.
+    Xapian::MSetCache cache(1024 * 1024);
+    enquire.set_mset_cache(cache);
+    enquire.get_mset(0, 10);
+    size_t entry_size = cache.get_size();
+
+    Xapian::MSetCache small_cache(entry_size + entry_size / 2);
+    enquire.set_mset_cache(small_cache);
+    enquire.get_mset(0, 10);
+    TEST_EQUAL(small_cache.get_entry_count(), 1);
+    enquire.set_query(Xapian::Query("word"));
+    enquire.get_mset(0, 10);
+    TEST_EQUAL(small_cache.get_entry_count(), 1);
+    TEST_REL(small_cache.get_size(), <=, small_cache.get_max_size());
+    // The least recently used entry should have been dropped.
+    enquire.get_mset(0, 10);
+    TEST_EQUAL(small_cache.get_hits(), 1);
+    enquire.set_query(Xapian::Query("this"));
+    enquire.get_mset(0, 10);
+    TEST_EQUAL(small_cache.get_hits(), 1);
+
+    // Nothing is cached if a single search doesn't fit.
+    Xapian::MSetCache tiny_cache(1);
+    enquire.set_mset_cache(tiny_cache);
+    enquire.get_mset(0, 10);
+    enquire.get_mset(0, 10);
+    TEST_EQUAL(tiny_cache.get_entry_count(), 0);
+    TEST_EQUAL(tiny_cache.get_misses(), 2);
+}
+
+/// Check cached results aren't used after the database changes.
+DEFINE_TESTCASE(msetcache4, glass) {
+    Xapian::WritableDatabase wdb = get_writable_database("apitest_simpledata");
+    // Writable databases can have uncommitted changes, so aren't cached.
+    Xapian::Enquire wenquire(wdb);
+    Xapian::MSetCache cache(1024 * 1024);
+    wenquire.set_mset_cache(cache);
+    wenquire.set_query(Xapian::Query("this"));
+    wenquire.get_mset(0, 10);
+    TEST_EQUAL(cache.get_misses(), 0);
+    wdb.commit();
+
+    Xapian::Database db = get_writable_database_as_database();
+    Xapian::Enquire enquire(db);
+    enquire.set_mset_cache(cache);
+    enquire.set_query(Xapian::Query("this"));
+    Xapian::doccount matches = enquire.get_mset(0, 10).size();
+    TEST_EQUAL(cache.get_misses(), 1);
+
+    Xapian::Document doc;
+    doc.add_term("this");
+    wdb.add_document(doc);
+    wdb.commit();
+
+    // Until reopen() is called, db is still reading the old revision.
+    TEST_EQUAL(enquire.get_mset(0, 10).size(), matches);
+    TEST_EQUAL(cache.get_hits(), 1);
+
+    TEST(db.reopen());
+    TEST_EQUAL(enquire.get_mset(0, 10).size(), matches + 1);
+    TEST_EQUAL(cache.get_hits(), 1);
+    TEST_EQUAL(cache.get_misses(), 2);
+}
@@ -605,6 +605,7 @@ class SlowDecreasingValueWeightPostingSource
 	return Xapian::DecreasingValueWeightPostingSource::next(min_wt);
     }
 };
+#endif
 
 static void
 make_matchtimelimit1_db(Xapian::WritableDatabase &db, const string &)
@@ -615,7 +616,6 @@ make_matchtimelimit1_db(Xapian::WritableDatabase &db, const string &)
 	db.add_document(doc);
     }
 }
-#endif
 
 // FIXME: This doesn't run for remote databases (we'd need to register
 // SlowDecreasingValueWeightPostingSource on the remote).
@@ -641,6 +641,107 @@ DEFINE_TESTCASE(matchtimelimit1, backend && !remote)
 #endif
 }
 
+/// PostingSource which sets a CancelFlag after a number of documents.
+class CancellingPostingSource
+    : public Xapian::DecreasingValueWeightPostingSource {
+  public:
+    Xapian::CancelFlag flag;
+
+    int count;
+
+    CancellingPostingSource(const Xapian::CancelFlag& flag_, int count_)
+	: Xapian::DecreasingValueWeightPostingSource(0),
+	  flag(flag_), count(count_) { }
+
+    CancellingPostingSource * clone() const
+    {
+	return new CancellingPostingSource(flag, count);
+    }
+
+    void next(double min_wt) {
+	if (--count == 0)
+	    flag.cancel();
+	return Xapian::DecreasingValueWeightPostingSource::next(min_wt);
+    }
+};
+
+// FIXME: This doesn't run for remote databases because we'd need to register
+// CancellingPostingSource on the remote (matchcancel2 tests cancelling a
+// remote match).
+DEFINE_TESTCASE(matchcancel1, backend && !remote)
+{
+    Xapian::Database db = get_database("matchtimelimit1",
+				       make_matchtimelimit1_db);
+
+    Xapian::CancelFlag flag;
+    CancellingPostingSource src(flag, 3);
+    src.init(db);
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query(&src));
+    enquire.set_cancel_flag(flag);
+
+    // The match should stop after the third document.  The counts of
+    // matching documents should come from the estimates (which are exact for
+    // this posting source) rather than from the three documents seen.
+    Xapian::MSet mset = enquire.get_mset(0, 10, 1000);
+    TEST(flag.is_cancelled());
+    TEST(mset.was_cancelled());
+    TEST_EQUAL(mset.size(), 3);
+    TEST_EQUAL(mset.get_matches_lower_bound(), 20);
+    TEST_EQUAL(mset.get_matches_estimated(), 20);
+    TEST_EQUAL(mset.get_matches_upper_bound(), 20);
+
+    // The flag is still set, so nothing should be returned.
+    mset = enquire.get_mset(0, 10, 1000);
+    TEST(mset.was_cancelled());
+    TEST_EQUAL(mset.size(), 0);
+    TEST_EQUAL(mset.get_matches_estimated(), 20);
+    TEST_EQUAL(mset.get_matches_upper_bound(), 20);
+
+    flag.reset();
+    TEST(!flag.is_cancelled());
+    enquire.clear_cancel_flag();
+    flag.cancel();
+    mset = enquire.get_mset(0, 10, 1000);
+    TEST(!mset.was_cancelled());
+    TEST_EQUAL(mset.size(), 10);
+    TEST_EQUAL(mset.get_matches_estimated(), 20);
+}
+
+/// Check a cancelled match reports estimates, including for remote shards.
+DEFINE_TESTCASE(matchcancel2, backend)
+{
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_OR,
+				    Xapian::Query("this"),
+				    Xapian::Query("paragraph")));
+    Xapian::MSet full = enquire.get_mset(0, 10);
+    TEST(!full.was_cancelled());
+    TEST_REL(full.size(), >, 0);
+
+    // If the flag is already set, no documents are looked at, but the
+    // estimates should still cover all the matches.
+    Xapian::CancelFlag flag;
+    flag.cancel();
+    enquire.set_cancel_flag(flag);
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST(mset.was_cancelled());
+    TEST_EQUAL(mset.size(), 0);
+    TEST_REL(mset.get_matches_upper_bound(), >=,
+	     full.get_matches_upper_bound());
+    TEST_REL(mset.get_matches_estimated(), >, 0);
+    TEST_REL(mset.get_matches_lower_bound(), <=,
+	     full.get_matches_lower_bound());
+
+    // Remote servers may see a request to stop after they've finished the
+    // match, which should be ignored.
+    enquire.clear_cancel_flag();
+    mset = enquire.get_mset(0, 10);
+    TEST(!mset.was_cancelled());
+    TEST(mset_range_is_same(mset, 0, full, 0, full.size()));
+}
+
 class CheckBoundsPostingSource
     : public Xapian::DecreasingValueWeightPostingSource {
   public:
@@ -114,3 +114,92 @@ DEFINE_TESTCASE(stemlangs2, !backend) {
     TEST(stem.is_none());
     TEST_EQUAL(stem.get_description(), "Xapian::Stem(none)");
 }
+
+/// Test the cache of stemmed words.
+DEFINE_TESTCASE(stemcache1, !backend) {
+    static const char* const words[] = {
+	"running", "runs", "ran", "connection", "connected", "running",
+	"generalizations", "a", "runs", "connection", "oscillators"
+    };
+    Xapian::Stem stem("en");
+    Xapian::Stem cached("en");
+    TEST_EQUAL(cached.get_cache_hits(), 0);
+    TEST_EQUAL(cached.get_cache_misses(), 0);
+    // A cache with a single slot is the most likely to have collisions.
+    for (size_t size : { 1, 2, 1000 }) {
+	cached.set_cache_size(size);
+	for (int repeat = 0; repeat != 3; ++repeat) {
+	    for (auto word : words) {
+		TEST_EQUAL(cached(word), stem(word));
+	    }
+	}
+	TEST_EQUAL(cached.get_cache_hits() + cached.get_cache_misses(),
+		   3 * (sizeof(words) / sizeof(words[0])));
+    }
+    // With enough space, each different word is only stemmed once.
+    TEST_EQUAL(cached.get_cache_misses(), 8);
+    TEST_EQUAL(cached.get_cache_hits(), 25);
+    // Empty words aren't passed to the stemmer, so aren't counted.
+    TEST_EQUAL(cached(string()), string());
+    TEST_EQUAL(cached.get_cache_misses(), 8);
+
+    // Copies share the cache.
+    Xapian::Stem copy = cached;
+    TEST_EQUAL(copy("running"), "run");
+    TEST_EQUAL(cached.get_cache_hits(), 26);
+
+    cached.set_cache_size(0);
+    TEST_EQUAL(cached("running"), "run");
+    TEST_EQUAL(cached.get_cache_hits(), 0);
+    TEST_EQUAL(cached.get_cache_misses(), 0);
+    TEST_EQUAL(copy.get_cache_hits(), 26);
+
+    Xapian::Stem none;
+    none.set_cache_size(100);
+    TEST_EQUAL(none("running"), "running");
+    TEST_EQUAL(none.get_cache_misses(), 0);
+    TEST(none.is_none());
+    TEST_EQUAL(none.get_description(), "Xapian::Stem(none)");
+
+    // The cache works with user stemming algorithms, and doesn't change the
+    // description.  Setting the size again replaces the cache rather than
+    // caching the cache.
+    Xapian::Stem user(new MyStemImpl);
+    user.set_cache_size(16);
+    user.set_cache_size(8);
+    TEST_EQUAL(user.get_description(), "Xapian::Stem(MyStem())");
+    TEST_EQUAL(user("food"), "foo");
+    TEST_EQUAL(user("vanish"), "");
+    TEST_EQUAL(user("vanish"), "");
+    TEST_EQUAL(user.get_cache_misses(), 2);
+    TEST_EQUAL(user.get_cache_hits(), 1);
+    user.set_cache_size(0);
+    TEST_EQUAL(user.get_description(), "Xapian::Stem(MyStem())");
+    TEST_EQUAL(user("food"), "foo");
+    TEST_EQUAL(user.get_cache_misses(), 0);
+
+    // Check TermGenerator generates the same terms with a cache.
+    const char* text = "The runner was running, and runs as the runners run.";
+    Xapian::TermGenerator tg;
+    tg.set_stemmer(stem);
+    Xapian::Document doc;
+    tg.set_document(doc);
+    tg.index_text(text);
+    Xapian::TermGenerator cached_tg;
+    cached_tg.set_stemmer_cache_size(64);
+    cached_tg.set_stemmer(stem);
+    Xapian::Document cached_doc;
+    cached_tg.set_document(cached_doc);
+    cached_tg.index_text(text);
+    TEST_EQUAL(cached_doc.termlist_count(), doc.termlist_count());
+    for (auto i = doc.termlist_begin(), j = cached_doc.termlist_begin();
+	 i != doc.termlist_end(); ++i, ++j) {
+	TEST_EQUAL(*j, *i);
+	TEST_EQUAL(j.get_wdf(), i.get_wdf());
+    }
+    TEST_STRINGS_EQUAL(Xapian::Stem(cached_tg.get_stemmer()).get_description(),
+		       stem.get_description());
+    TEST_REL(cached_tg.get_stemmer().get_cache_hits(), >, 0);
+    // The Stem object passed to set_stemmer() isn't affected.
+    TEST_EQUAL(stem.get_cache_misses(), 0);
+}
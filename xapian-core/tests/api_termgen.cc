@@ -137,6 +137,11 @@ static const test test_simple[] = {
 
     { "", "fish+chips", "Zchip:1 Zfish:1 chips[2] fish[1]" },
 
+    // Test runs of ASCII characters mixed with other characters.  U+212A
+    // KELVIN SIGN lower cases to ASCII 'k'.
+    { "", "Foo_Bar9\xc3\xa9""Baz ,;-- \xe2\x84\xaa""ELVIN\xc2\xa0x.y \xc3\xa9""A'B",
+      "Zfoo_bar9\xc3\xa9""baz:1 Zkelvin:1 Zx:1 Zy:1 Z\xc3\xa9""a'b:1 foo_bar9\xc3\xa9""baz[1] kelvin[2] x[3] y[4] \xc3\xa9""a'b[5]" },
+
     // Basic ngram tests:
     { "stem=,ngrams", "久有归天", "久[1] 久有:1 天[4] 归[3] 归天:1 有[2] 有归:1" },
     { "", "극지라", "극[1] 극지:1 라[3] 지[2] 지라:1" },
@@ -1987,6 +1987,35 @@ DEFINE_TESTCASE(modifyvalues1, writable) {
     check_vals(db, vals);
 }
 
+/// Test skip_to() over a postlist with deleted documents in it.
+DEFINE_TESTCASE(skiptodeleted1, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    Xapian::Document doc;
+    doc.add_term("t");
+    for (int i = 0; i < 1000; ++i) {
+	db.add_document(doc);
+    }
+    for (Xapian::docid did = 2; did <= 600; ++did) {
+	db.delete_document(did);
+    }
+    db.delete_document(700);
+    db.delete_document(1000);
+    db.commit();
+
+    Xapian::PostingIterator p = db.postlist_begin("t");
+    TEST_EQUAL(*p, 1);
+    p.skip_to(2);
+    TEST_EQUAL(*p, 601);
+    p.skip_to(650);
+    TEST_EQUAL(*p, 650);
+    p.skip_to(700);
+    TEST_EQUAL(*p, 701);
+    p.skip_to(999);
+    TEST_EQUAL(*p, 999);
+    p.skip_to(1000);
+    TEST(p == db.postlist_end("t"));
+}
+
 /** Regression test for protocol design bug.
  *
  *  Previously some messages didn't send a reply but could result in an
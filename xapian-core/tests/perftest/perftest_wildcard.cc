@@ -0,0 +1,150 @@
+/** @file
+ * @brief performance tests for queries which expand to many terms
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "perftest/perftest_wildcard.h"
+
+#include <string>
+#include <vector>
+#include <xapian.h>
+
+#include "backendmanager.h"
+#include "perftest.h"
+#include "str.h"
+#include "testrunner.h"
+#include "testsuite.h"
+#include "testutils.h"
+
+using namespace std;
+
+/// Number of distinct terms starting with "w".
+static const unsigned WIDE_TERMS = 2000;
+
+static void
+builddb_widetermstest1(Xapian::WritableDatabase &db, const string & dbname)
+{
+    logger.testcase_begin(dbname);
+    unsigned int runsize = 20000;
+
+    std::map<std::string, std::string> params;
+    params["runsize"] = str(runsize);
+    params["terms"] = str(WIDE_TERMS);
+    logger.indexing_begin(dbname, params);
+    for (unsigned int i = 0; i < runsize; ++i) {
+	Xapian::Document doc;
+	doc.set_data("test document " + str(i));
+	doc.add_term("foo");
+	// Each document gets a few of the "w" terms, with a different wdf for
+	// each so the weighted queries have some work to do.
+	for (unsigned int j = 0; j != 5; ++j) {
+	    unsigned t = (i * 7 + j * 397) % WIDE_TERMS;
+	    doc.add_term("w" + str(t), j + 1);
+	}
+	db.add_document(doc);
+	logger.indexing_add();
+    }
+    db.commit();
+    logger.indexing_end();
+    logger.testcase_end();
+}
+
+static void
+run_wide_query(Xapian::Enquire& enquire, const Xapian::Query& query,
+	       const string& description)
+{
+    logger.searching_start(description);
+    enquire.set_query(query);
+    for (int repeat = 0; repeat != 5; ++repeat) {
+	logger.search_start();
+	Xapian::MSet mset = enquire.get_mset(0, 10);
+	logger.search_end(query, mset);
+	TEST_EQUAL(mset.size(), 10);
+    }
+    logger.searching_end();
+}
+
+// Test the performance of wildcards which expand to many terms.
+DEFINE_TESTCASE(widewildcard1, writable && !remote && !inmemory) {
+    Xapian::Database db;
+    db = backendmanager->get_database("widetermstest1",
+				      builddb_widetermstest1,
+				      "widetermstest1");
+
+    logger.testcase_begin("widewildcard1");
+    Xapian::Enquire enquire(db);
+
+    run_wide_query(enquire,
+		   Xapian::Query(Xapian::Query::OP_WILDCARD, "w", 0,
+				 Xapian::Query::WILDCARD_LIMIT_ERROR,
+				 Xapian::Query::OP_OR),
+		   "Wildcard expanded with OP_OR");
+    run_wide_query(enquire,
+		   Xapian::Query(Xapian::Query::OP_WILDCARD, "w", 0,
+				 Xapian::Query::WILDCARD_LIMIT_ERROR,
+				 Xapian::Query::OP_SYNONYM),
+		   "Wildcard expanded with OP_SYNONYM");
+    run_wide_query(enquire,
+		   Xapian::Query(Xapian::Query::OP_WILDCARD, "w", 0,
+				 Xapian::Query::WILDCARD_LIMIT_ERROR,
+				 Xapian::Query::OP_MAX),
+		   "Wildcard expanded with OP_MAX");
+    run_wide_query(enquire,
+		   Xapian::Query(Xapian::Query::OP_WILDCARD, "w", 200,
+				 Xapian::Query::WILDCARD_LIMIT_MOST_FREQUENT,
+				 Xapian::Query::OP_OR),
+		   "Wildcard limited to 200 most frequent terms");
+
+    logger.testcase_end();
+}
+
+// Test the performance of OP_SYNONYM and OP_OR with many subqueries.
+DEFINE_TESTCASE(widesynonym1, writable && !remote && !inmemory) {
+    Xapian::Database db;
+    db = backendmanager->get_database("widetermstest1",
+				      builddb_widetermstest1,
+				      "widetermstest1");
+
+    logger.testcase_begin("widesynonym1");
+    Xapian::Enquire enquire(db);
+
+    vector<Xapian::Query> subqs;
+    for (unsigned t = 0; t < WIDE_TERMS; t += 2) {
+	subqs.emplace_back("w" + str(t));
+    }
+
+    run_wide_query(enquire,
+		   Xapian::Query(Xapian::Query::OP_SYNONYM,
+				 subqs.begin(), subqs.end()),
+		   "OP_SYNONYM of " + str(subqs.size()) + " terms");
+    run_wide_query(enquire,
+		   Xapian::Query(Xapian::Query::OP_OR,
+				 subqs.begin(), subqs.end()),
+		   "OP_OR of " + str(subqs.size()) + " terms");
+    run_wide_query(enquire,
+		   Xapian::Query(Xapian::Query::OP_AND,
+				 Xapian::Query("foo"),
+				 Xapian::Query(Xapian::Query::OP_SYNONYM,
+					       subqs.begin(), subqs.end())),
+		   "OP_AND of a term and OP_SYNONYM of " + str(subqs.size()) +
+		   " terms");
+
+    logger.testcase_end();
+}
@@ -26,6 +26,7 @@
 #include "xapian-letor/featurelist.h"
 
 #include <map>
+#include <utility>
 
 namespace Xapian {
 
@@ -85,6 +86,11 @@ class Feature::Internal : public Xapian::Internal::intrusive_base {
 	return feature_doc;
     }
 
+    /// Set the document to use for Feature building.
+    void set_document(const Xapian::Document& doc) {
+	feature_doc = doc;
+    }
+
     /// Get termfreq
     Xapian::termcount get_termfreq(const std::string& term) const;
 
@@ -102,12 +108,12 @@ class Feature::Internal : public Xapian::Internal::intrusive_base {
 
     /// Set the term frequency to use for Feature building.
     void set_termfreq(std::map<std::string, Xapian::termcount>&& tf) {
-	termfreq = tf;
+	termfreq = std::move(tf);
     }
 
     /// Set the inverse_doc_freq to use for Feature building.
     void set_inverse_doc_freq(std::map<std::string, double>&& idf) {
-	inverse_doc_freq = idf;
+	inverse_doc_freq = std::move(idf);
     }
 
     /** Set the doc_length to use for Feature building.
@@ -115,19 +121,19 @@ class Feature::Internal : public Xapian::Internal::intrusive_base {
      *  This is used by Feature::Internal while populating Statistics.
      */
     void set_doc_length(std::map<std::string, Xapian::termcount>&& doc_len) {
-	doc_length = doc_len;
+	doc_length = std::move(doc_len);
     }
 
     /// Set the collection_length to use for Feature building.
     void set_collection_length(std::map<std::string,
 					Xapian::termcount>&& collection_len) {
-	collection_length = collection_len;
+	collection_length = std::move(collection_len);
     }
 
     /// Set the collection_termfreq to use for Feature building.
     void set_collection_termfreq(std::map<std::string,
 					  Xapian::termcount>&& collection_tf) {
-	collection_termfreq = collection_tf;
+	collection_termfreq = std::move(collection_tf);
     }
 };
 
@@ -104,30 +104,23 @@ FeatureList::create_feature_vectors(const Xapian::MSet & mset,
     LOGCALL(API, std::vector<FeatureVector>, "FeatureList::create_feature_vectors", mset | letor_query | letor_db);
     if (mset.empty())
 	return vector<FeatureVector>();
-    std::vector<FeatureVector> fvec;
     Assert(!internal->feature.empty());
 
-    for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
-	Xapian::Document doc = i.get_document();
-	std::vector<double> fvals;
-	internal->set_data(letor_query, letor_db, doc);
-	auto internal_feature = new Feature::Internal(letor_db,
-						      letor_query, doc);
-	// Computes and populates the Feature::Internal with required stats.
-	internal->populate_feature_internal(internal_feature);
-	for (Feature* it : internal->feature) {
-	    it->internal = internal_feature;
-	    const vector<double>& values = it->get_values();
-	    // Append feature values
-	    fvals.insert(fvals.end(), values.begin(), values.end());
-	}
-	double wt = i.get_weight();
-	// Weight is added as a feature by default.
-	fvals.push_back(wt);
-	Xapian::docid did = doc.get_docid();
-	// construct a FeatureVector object using did and fvals.
-	Xapian::FeatureVector fv(did, fvals);
-	fvec.push_back(fv);
+    internal->set_data(letor_query, letor_db);
+    // Feature values for all the documents, stored contiguously with one row
+    // per document.
+    std::vector<Xapian::docid> docids;
+    std::vector<double> values;
+    size_t num_features = internal->compute_feature_matrix(mset, docids,
+							   values);
+
+    std::vector<FeatureVector> fvec;
+    fvec.reserve(docids.size());
+    auto row = values.begin();
+    for (Xapian::docid did : docids) {
+	// construct a FeatureVector object using did and the row of values.
+	fvec.emplace_back(did, std::vector<double>(row, row + num_features));
+	row += num_features;
     }
     normalise(fvec);
     return fvec;
@@ -31,6 +31,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <utility>
 #include "debuglog.h"
 
 using namespace std;
@@ -38,27 +39,75 @@ using namespace Xapian;
 
 void
 FeatureList::Internal::set_data(const Xapian::Query & letor_query,
-				const Xapian::Database & letor_db,
-				const Xapian::Document & letor_doc)
+				const Xapian::Database & letor_db)
 {
     set_query(letor_query);
-    set_doc(letor_doc);
     set_database(letor_db);
 }
 
-std::map<std::string, Xapian::termcount>
-FeatureList::Internal::compute_termfreq() const
+void
+FeatureList::Internal::set_query(const Xapian::Query& query)
 {
-    std::map<std::string, Xapian::termcount> tf;
+    featurelist_query = query;
+    featurelist_query_terms.assign(query.get_unique_terms_begin(),
+				   query.get_terms_end());
+}
 
-    Xapian::TermIterator docterms = featurelist_doc.termlist_begin();
-    for (Xapian::TermIterator qt = featurelist_query.get_unique_terms_begin();
-	 qt != featurelist_query.get_terms_end(); ++qt) {
-	docterms.skip_to(*qt);
-	if (docterms != featurelist_doc.termlist_end() && *qt == *docterms)
-	    tf[*qt] = docterms.get_wdf();
+void
+FeatureList::Internal::compute_document_stats(
+	const Xapian::Document& doc,
+	std::map<std::string, Xapian::termcount>& tf,
+	std::map<std::string, Xapian::termcount>& len) const
+{
+    bool need_len = (stats_needed & DOCUMENT_LENGTH);
+    auto qt = featurelist_query_terms.begin();
+    auto qt_end = featurelist_query_terms.end();
+    if (!(stats_needed & TERM_FREQUENCY))
+	qt = qt_end;
+
+    // Both the query terms and the termlist are in ascending order, so we
+    // can merge them in a single pass, summing the wdf of the title terms
+    // (those with prefix "S") as we pass them.
+    Xapian::TermIterator dt = doc.termlist_begin();
+    Xapian::TermIterator dt_end = doc.termlist_end();
+    for ( ; qt != qt_end && *qt < "S" && dt != dt_end; ++qt) {
+	dt.skip_to(*qt);
+	if (dt != dt_end && *qt == *dt)
+	    tf[*qt] = dt.get_wdf();
+    }
+
+    if (need_len) {
+	Xapian::termcount title_len = 0;
+	if (dt != dt_end) {
+	    // reach the iterator to the start of the title terms
+	    dt.skip_to("S");
+	}
+	for ( ; dt != dt_end; ++dt) {
+	    const string& term = *dt;
+	    if (term[0] != 'S') {
+		// We've reached the end of the S-prefixed terms.
+		break;
+	    }
+	    Xapian::termcount wdf = dt.get_wdf();
+	    title_len += wdf;
+	    while (qt != qt_end && *qt < term)
+		++qt;
+	    if (qt != qt_end && *qt == term) {
+		tf[term] = wdf;
+		++qt;
+	    }
+	}
+	len["title"] = title_len;
+	Xapian::termcount whole_len = featurelist_db.get_doclength(doc.get_docid());
+	len["whole"] = whole_len;
+	len["body"] = whole_len - title_len;
+    }
+
+    for ( ; qt != qt_end && dt != dt_end; ++qt) {
+	dt.skip_to(*qt);
+	if (dt != dt_end && *qt == *dt)
+	    tf[*qt] = dt.get_wdf();
     }
-    return tf;
 }
 
 std::map<std::string, double>
@@ -67,39 +116,14 @@ FeatureList::Internal::compute_inverse_doc_freq() const
     std::map<std::string, double> idf;
     Xapian::doccount totaldocs = featurelist_db.get_doccount();
 
-    for (Xapian::TermIterator qt = featurelist_query.get_unique_terms_begin();
-	 qt != featurelist_query.get_terms_end(); ++qt) {
-	Xapian::doccount df = featurelist_db.get_termfreq(*qt);
+    for (const string& term : featurelist_query_terms) {
+	Xapian::doccount df = featurelist_db.get_termfreq(term);
 	if (df != 0)
-	    idf[*qt] = log10((double)totaldocs / (double)(1 + df));
+	    idf[term] = log10((double)totaldocs / (double)(1 + df));
     }
     return idf;
 }
 
-std::map<std::string, Xapian::termcount>
-FeatureList::Internal::compute_doc_length() const
-{
-    std::map<std::string, Xapian::termcount> len;
-
-    Xapian::termcount title_len = 0;
-    Xapian::TermIterator dt = featurelist_doc.termlist_begin();
-    // reach the iterator to the start of the title terms i.e. prefix "S"
-    dt.skip_to("S");
-    for ( ; dt != featurelist_doc.termlist_end(); ++dt) {
-	if ((*dt)[0] != 'S') {
-	    // We've reached the end of the S-prefixed terms.
-	    break;
-	}
-	title_len += dt.get_wdf();
-    }
-    len["title"] = title_len;
-    Xapian::termcount whole_len =
-	    featurelist_db.get_doclength(featurelist_doc.get_docid());
-    len["whole"] = whole_len;
-    len["body"] = whole_len - title_len;
-    return len;
-}
-
 std::map<std::string, Xapian::termcount>
 FeatureList::Internal::compute_collection_length() const
 {
@@ -136,28 +160,21 @@ FeatureList::Internal::compute_collection_termfreq() const
 {
     std::map<std::string, Xapian::termcount> tf;
 
-    for (Xapian::TermIterator qt = featurelist_query.get_unique_terms_begin();
-	 qt != featurelist_query.get_terms_end(); ++qt) {
-	Xapian::termcount coll_tf = featurelist_db.get_collection_freq(*qt);
+    for (const string& term : featurelist_query_terms) {
+	Xapian::termcount coll_tf = featurelist_db.get_collection_freq(term);
 	if (coll_tf != 0)
-	    tf[*qt] = coll_tf;
+	    tf[term] = coll_tf;
     }
     return tf;
 }
 
 void
-FeatureList::Internal::populate_feature_internal(Feature::Internal*
-						 internal_feature)
+FeatureList::Internal::populate_query_stats(Feature::Internal*
+					    internal_feature)
 {
-    if (stats_needed & TERM_FREQUENCY) {
-	internal_feature->set_termfreq(compute_termfreq());
-    }
     if (stats_needed & INVERSE_DOCUMENT_FREQUENCY) {
 	internal_feature->set_inverse_doc_freq(compute_inverse_doc_freq());
     }
-    if (stats_needed & DOCUMENT_LENGTH) {
-	internal_feature->set_doc_length(compute_doc_length());
-    }
     if (stats_needed & COLLECTION_LENGTH) {
 	internal_feature->set_collection_length(compute_collection_length());
     }
@@ -166,3 +183,58 @@ FeatureList::Internal::populate_feature_internal(Feature::Internal*
 			  compute_collection_termfreq());
     }
 }
+
+void
+FeatureList::Internal::populate_document_stats(Feature::Internal*
+					       internal_feature,
+					       const Xapian::Document& doc)
+{
+    internal_feature->set_document(doc);
+    if (stats_needed & (TERM_FREQUENCY | DOCUMENT_LENGTH)) {
+	std::map<std::string, Xapian::termcount> tf, len;
+	compute_document_stats(doc, tf, len);
+	internal_feature->set_termfreq(std::move(tf));
+	internal_feature->set_doc_length(std::move(len));
+    }
+}
+
+size_t
+FeatureList::Internal::compute_feature_matrix(const Xapian::MSet& mset,
+					      std::vector<Xapian::docid>& docids,
+					      std::vector<double>& values)
+{
+    // Hint that we're going to want all the documents.
+    mset.fetch();
+
+    // The statistics which don't depend on the document are calculated once
+    // and shared by all the documents and features.
+    Xapian::Internal::intrusive_ptr<Feature::Internal> internal_feature(
+	new Feature::Internal(featurelist_db, featurelist_query,
+			      Xapian::Document()));
+    populate_query_stats(internal_feature.get());
+    for (Feature* it : feature) {
+	it->internal = internal_feature;
+    }
+
+    size_t num_features = 0;
+    docids.clear();
+    docids.reserve(mset.size());
+    values.clear();
+    for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	Xapian::Document doc = i.get_document();
+	docids.push_back(doc.get_docid());
+	populate_document_stats(internal_feature.get(), doc);
+	for (Feature* it : feature) {
+	    const vector<double>& fvals = it->get_values();
+	    // Append feature values
+	    values.insert(values.end(), fvals.begin(), fvals.end());
+	}
+	// Weight is added as a feature by default.
+	values.push_back(i.get_weight());
+	if (num_features == 0) {
+	    num_features = values.size();
+	    values.reserve(num_features * mset.size());
+	}
+    }
+    return num_features;
+}
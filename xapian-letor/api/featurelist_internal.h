@@ -28,6 +28,8 @@
 #include "api/feature_internal.h"
 
 #include <map>
+#include <string>
+#include <vector>
 
 namespace Xapian {
 
@@ -58,18 +60,31 @@ class FeatureList::Internal : public Xapian::Internal::intrusive_base {
     /// Xapian::Query using which features will be calculated.
     Query featurelist_query;
 
-    /// Xapian::Document using which features will be calculated.
-    Document featurelist_doc;
+    /// Unique terms from featurelist_query, in ascending order.
+    std::vector<std::string> featurelist_query_terms;
 
     /** This method finds the frequency of the query terms in the
-     *  specified documents.
+     *  specified document and the length of the document.
+     *
+     *  The termlist of the document is only walked once to find both the
+     *  frequency of each query term and the number of title terms, since
+     *  fetching and decoding the termlist is the most costly part of
+     *  computing the per-document statistics.
      *
      *  This method is a helper method and statistics gathered through
      *  this method are used in feature value calculation.
      *
-     *  @return A map from query terms to their term frequencies.
+     *  @param doc		The document to compute statistics for.
+     *  @param[out] tf	Set to a map from query terms to their term
+     *			frequencies in @a doc.
+     *  @param[out] len	Set to a map giving the length of @a doc for
+     *			"title", "body" and "whole" (only if
+     *			DOCUMENT_LENGTH is needed).
      */
-    std::map<std::string, Xapian::termcount> compute_termfreq() const;
+    void compute_document_stats(const Xapian::Document& doc,
+				std::map<std::string, Xapian::termcount>& tf,
+				std::map<std::string, Xapian::termcount>& len)
+	const;
 
     /** This method calculates the inverse document frequency(idf) of query
      *  terms in the database.
@@ -87,23 +102,6 @@ class FeatureList::Internal : public Xapian::Internal::intrusive_base {
      */
     std::map<std::string, double> compute_inverse_doc_freq() const;
 
-    /** This method calculates the length of the documents as number of 'terms'.
-     *  It calculates the length for three different parts:
-     *  title, body and whole document.
-     *
-     *  This method is a helper method and statistics gathered through
-     *  this method are used in feature value calculation.
-     *
-     *  @return A map from query terms to their document lengths.
-     *  @code
-     *  map<string, long int> len;
-     *  len["title"];
-     *  len["body"];
-     *  len["whole"];
-     *  @endcode
-     */
-    std::map<std::string, Xapian::termcount> compute_doc_length() const;
-
     /** This method calculates the length of the collection in number of terms
      *  for different parts like 'title', 'body' and 'whole'.
      *
@@ -148,20 +146,18 @@ class FeatureList::Internal : public Xapian::Internal::intrusive_base {
      *
      *  This will be used by the Internal class.
      */
-    void set_query(const Xapian::Query& query) {
-	featurelist_query = query;
-    }
+    void set_query(const Xapian::Query& query);
 
-    /** Specify the document to use for feature building.
+    /** Computes and populates the stats needed by a Feature which don't
+     *  depend on the document.
      *
-     *  This will be used by the Internal class.
+     *  These only need to be computed once per query.
      */
-    void set_doc(const Xapian::Document& doc) {
-	featurelist_doc = doc;
-    }
+    void populate_query_stats(Feature::Internal* internal_feature);
 
-    /// Computes and populates the stats needed by a Feature.
-    void populate_feature_internal(Feature::Internal* internal_feature);
+    /// Computes and populates the per-document stats needed by a Feature.
+    void populate_document_stats(Feature::Internal* internal_feature,
+				 const Xapian::Document& doc);
 
   public:
 
@@ -172,8 +168,23 @@ class FeatureList::Internal : public Xapian::Internal::intrusive_base {
 
     /// This method sets all the data members required for computing stats.
     void set_data(const Xapian::Query& query,
-		  const Xapian::Database& db,
-		  const Xapian::Document& doc);
+		  const Xapian::Database& db);
+
+    /** Compute the feature values for each document in an MSet.
+     *
+     *  The values are stored in @a values as a documents-by-features
+     *  matrix in row-major order.
+     *
+     *  @param mset		The MSet to compute features for.
+     *  @param[out] docids	The docid of each document (as reported by
+     *			Document::get_docid()).
+     *  @param[out] values	The feature values.
+     *
+     *  @return The number of feature values for each document.
+     */
+    size_t compute_feature_matrix(const Xapian::MSet& mset,
+				  std::vector<Xapian::docid>& docids,
+				  std::vector<double>& values);
 };
 
 }
@@ -1,10 +1,12 @@
 noinst_HEADERS +=\
-	common/serialise-double.h
+	common/serialise-double.h\
+	ranker/featurematrix.h
 
 EXTRA_DIST +=\
 	ranker/Makefile
 
 lib_src +=\
+	ranker/featurematrix.cc\
 	ranker/listmle_ranker.cc\
 	ranker/listnet_ranker.cc\
 	ranker/ranker.cc\
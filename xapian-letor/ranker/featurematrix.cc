@@ -0,0 +1,84 @@
+/** @file
+ *  @brief Feature vectors packed into a contiguous matrix for training
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "featurematrix.h"
+
+#include "xapian/error.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+FeatureMatrix::FeatureMatrix(const vector<Xapian::FeatureVector>& fvv,
+			     size_t num_features_,
+			     const vector<size_t>* order)
+    : num_features(num_features_)
+{
+    fvals.reserve(fvv.size() * num_features);
+    labels.reserve(fvv.size());
+    for (size_t i = 0; i != fvv.size(); ++i) {
+	const Xapian::FeatureVector& v = fvv[order ? (*order)[i] : i];
+	const vector<double>& row = v.get_fvals();
+	fvals.insert(fvals.end(), row.begin(), row.end());
+	labels.push_back(v.get_label());
+    }
+}
+
+vector<FeatureMatrix>
+pack_training_data(const vector<vector<Xapian::FeatureVector>>& training_data,
+		   bool (*comp)(const Xapian::FeatureVector&,
+				const Xapian::FeatureVector&))
+{
+    if (training_data.empty() || training_data[0].empty())
+	throw Xapian::InvalidArgumentError("Cannot train: no training data");
+    int feature_cnt = training_data[0][0].get_fcount();
+
+    vector<FeatureMatrix> result;
+    result.reserve(training_data.size());
+    vector<size_t> order;
+    for (auto& item1 : training_data) {
+	for (auto& item2 : item1) {
+	    if (item2.get_fcount() != feature_cnt) {
+		throw Xapian::InvalidArgumentError("Cannot train: training "
+						   "data has uneven set of "
+						   "features. Make sure that "
+						   "you are using the same "
+						   "set of Features for all "
+						   "the queries");
+	    }
+	}
+	if (!comp) {
+	    result.emplace_back(item1, feature_cnt);
+	    continue;
+	}
+	// Sort indices rather than the FeatureVector objects themselves so
+	// we don't need to copy the training data.
+	order.resize(item1.size());
+	iota(order.begin(), order.end(), size_t(0));
+	stable_sort(order.begin(), order.end(),
+		    [&](size_t a, size_t b) {
+			return comp(item1[a], item1[b]);
+		    });
+	result.emplace_back(item1, feature_cnt, &order);
+    }
+    return result;
+}
@@ -0,0 +1,123 @@
+/** @file
+ *  @brief Feature vectors packed into a contiguous matrix for training
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_FEATUREMATRIX_H
+#define XAPIAN_INCLUDED_FEATUREMATRIX_H
+
+#include "xapian-letor/featurevector.h"
+
+#include <cstddef>
+#include <vector>
+
+/** The FeatureVector objects for one query, packed into a matrix.
+ *
+ *  FeatureVector::get_fvals() returns a copy of the feature values, and
+ *  the rows are spread around the heap, so the training loops work on
+ *  this instead.  The feature values are stored in row-major order with
+ *  one row per document.
+ */
+class FeatureMatrix {
+    /// Number of features in each row.
+    size_t num_features;
+
+    /// The feature values.
+    std::vector<double> fvals;
+
+    /// The label of each row.
+    std::vector<double> labels;
+
+  public:
+    /** Pack a list of FeatureVector objects.
+     *
+     *  @param fvv	The FeatureVector objects for one query, which must
+     *			all have @a num_features_ features.
+     *  @param num_features_	Number of features in each FeatureVector.
+     *  @param order	If not NULL, the index in @a fvv of the
+     *			FeatureVector to use for each row.  Otherwise the
+     *			rows are in the same order as @a fvv.
+     */
+    FeatureMatrix(const std::vector<Xapian::FeatureVector>& fvv,
+		  size_t num_features_,
+		  const std::vector<size_t>* order = NULL);
+
+    /// Return the number of rows (documents).
+    size_t rows() const { return labels.size(); }
+
+    /// Return the number of columns (features).
+    size_t columns() const { return num_features; }
+
+    /// Return a pointer to the feature values for row @a i.
+    const double* row(size_t i) const { return &fvals[i * num_features]; }
+
+    /// Return the label for row @a i.
+    double label(size_t i) const { return labels[i]; }
+};
+
+/** Pack training data into FeatureMatrix objects.
+ *
+ *  @param training_data	The FeatureVector objects for each query.
+ *  @param comp			If not NULL, sort the rows for each query with
+ *				this comparison function.  The sort is stable.
+ *
+ *  @return A FeatureMatrix for each query.
+ *
+ *  @exception Xapian::InvalidArgumentError if @a training_data is empty or
+ *		the FeatureVector objects don't all have the same number of
+ *		features.
+ */
+std::vector<FeatureMatrix>
+pack_training_data(const std::vector<std::vector<Xapian::FeatureVector>>&
+		   training_data,
+		   bool (*comp)(const Xapian::FeatureVector&,
+				const Xapian::FeatureVector&) = NULL);
+
+/** Calculate the inner product of two vectors of length @a n.
+ *
+ *  This is the innermost operation when training, so we use several
+ *  independent accumulators.  This means the additions don't form a
+ *  single dependency chain, which allows the compiler to use SIMD
+ *  instructions and keeps the FPU pipelines busy.
+ */
+inline double
+inner_product(const double* a, const double* b, size_t n)
+{
+    double sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+    size_t i = 0;
+    for ( ; i + 4 <= n; i += 4) {
+	sum0 += a[i] * b[i];
+	sum1 += a[i + 1] * b[i + 1];
+	sum2 += a[i + 2] * b[i + 2];
+	sum3 += a[i + 3] * b[i + 3];
+    }
+    for ( ; i < n; ++i) {
+	sum0 += a[i] * b[i];
+    }
+    return (sum0 + sum1) + (sum2 + sum3);
+}
+
+/// Add @a factor times the vector @a x of length @a n to @a y.
+inline void
+add_scaled(double* y, const double* x, double factor, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+	y[i] += factor * x[i];
+    }
+}
+
+#endif // XAPIAN_INCLUDED_FEATUREMATRIX_H
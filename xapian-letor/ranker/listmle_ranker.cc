@@ -31,6 +31,7 @@
 #include "xapian-letor/ranker.h"
 
 #include "debuglog.h"
+#include "featurematrix.h"
 #include "serialise-double.h"
 
 #include <xapian.h>
@@ -54,51 +55,36 @@ label_comparer(const FeatureVector& firstfv,
     return firstfv.get_label() > secondfv.get_label();
 }
 
-static double
-calculate_inner_product(const vector<double>& parameters,
-			const vector<double>& feature_sets)
-{
-    double inner_product = 0.0;
-    for (size_t i = 0; i < parameters.size(); ++i) {
-	inner_product += parameters[i] * feature_sets[i];
-    }
-    return inner_product;
-}
-
-static vector<double>
-calculate_gradient(const vector<FeatureVector>& sorted_feature_vectors,
-		   const vector<double>& new_parameters)
+static void
+calculate_gradient(const FeatureMatrix& sorted_feature_matrix,
+		   const vector<double>& new_parameters,
+		   vector<double>& exponents,
+		   vector<double>& gradient)
 {
-    vector<double> gradient(sorted_feature_vectors[0].get_fcount(), 0);
+    size_t num_features = sorted_feature_matrix.columns();
+    gradient.assign(num_features, 0.0);
 
-    size_t list_length = sorted_feature_vectors.size();
+    size_t list_length = sorted_feature_matrix.rows();
 
-    vector<double> exponents;
+    exponents.resize(list_length);
     double expsum = 0.0;
 
     for (size_t i = 0; i < list_length; ++i) {
-	const auto& fvals = sorted_feature_vectors[i].get_fvals();
-	double exponent = exp(calculate_inner_product(new_parameters, fvals));
-	exponents.push_back(exponent);
+	const double* fvals = sorted_feature_matrix.row(i);
+	double exponent = exp(inner_product(new_parameters.data(), fvals,
+					    num_features));
+	exponents[i] = exponent;
 	expsum += exponent;
     }
 
+    // The last feature isn't included in the gradient.
     for (size_t i = 0; i < list_length; ++i) {
-	vector<double> feature_sets = sorted_feature_vectors[i].get_fvals();
-	for (size_t j = 0; j < feature_sets.size() - 1; ++j) {
-	    gradient[j] += feature_sets[j] * exponents[i] / expsum;
-	}
+	add_scaled(gradient.data(), sorted_feature_matrix.row(i),
+		   exponents[i] / expsum, num_features - 1);
     }
 
-    vector<double> first_place_in_ground_truth_feature_sets =
-	    sorted_feature_vectors[0].get_fvals();
-
-    for (size_t i = 0; i < first_place_in_ground_truth_feature_sets.size() - 1;
-	 ++i) {
-	gradient[i] -= first_place_in_ground_truth_feature_sets[i];
-    }
-
-    return gradient;
+    add_scaled(gradient.data(), sorted_feature_matrix.row(0), -1.0,
+	       num_features - 1);
 }
 
 static void
@@ -112,47 +98,30 @@ update_parameters(vector<double>& new_parameters,
     }
 }
 
-/* Updates new_parameters after calculating the gradient.
- * new_parameters(w) is updated as: w = w - gradient * learningRate
- */
-static void
-batch_learning(vector<FeatureVector> feature_vectors,
-	       vector<double> & new_parameters,
-	       double learning_rate)
-{
-    sort(feature_vectors.begin(), feature_vectors.end(), label_comparer);
-    const auto& gradient = calculate_gradient(feature_vectors, new_parameters);
-    update_parameters(new_parameters, gradient, learning_rate);
-}
-
 void
 ListMLERanker::train(const vector<vector<FeatureVector>>& training_data)
 {
     LOGCALL_VOID(API, "ListMLERanker::train", training_data);
     if (training_data.empty() || training_data[0].empty())
 	throw InvalidArgumentError("Cannot train: no training data");
-    int feature_cnt = training_data[0][0].get_fcount();
 
-    // Initialize the parameters for neural network
-    vector<double> new_parameters;
-    for (int feature_num = 0; feature_num < feature_cnt; ++feature_num) {
-	new_parameters.push_back(0.0);
-    }
+    // The order of the feature vectors for each query only depends on
+    // their labels, so sort them once up front rather than on every
+    // iteration.
+    vector<FeatureMatrix> queries = pack_training_data(training_data,
+						       label_comparer);
 
-    for (auto& item1 : training_data) {
-	for (auto& item2 : item1) {
-	    if (item2.get_fcount() != feature_cnt) {
-		throw InvalidArgumentError("Cannot train: training data has "
-					   "uneven set of features. Make sure "
-					   "that you are using the same set "
-					   "of Features for all the queries");
-	    }
-	}
-    }
+    // Initialize the parameters for neural network
+    vector<double> new_parameters(queries[0].columns(), 0.0);
 
+    vector<double> exponents, gradient;
     for (int iter_num = 1; iter_num <= iterations; ++iter_num) {
-	for (auto& item : training_data) {
-	    batch_learning(item, new_parameters, learning_rate);
+	for (auto& item : queries) {
+	    if (item.rows() == 0)
+		continue;
+	    // Update new_parameters (w) as: w = w - gradient * learningRate
+	    calculate_gradient(item, new_parameters, exponents, gradient);
+	    update_parameters(new_parameters, gradient, learning_rate);
 	}
     }
 
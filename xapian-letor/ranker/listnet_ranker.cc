@@ -31,6 +31,7 @@
 #include "xapian-letor/ranker.h"
 
 #include "debuglog.h"
+#include "featurematrix.h"
 #include "serialise-double.h"
 
 #include <algorithm>
@@ -45,70 +46,41 @@
 using namespace std;
 using namespace Xapian;
 
-/// A vector holding ground truth and prediction score probability distribution vectors.
-typedef vector<vector<double>> prob_distrib_vector;
-
 ListNETRanker::~ListNETRanker() {
     LOGCALL_DTOR(API, "ListNETRanker");
 }
 
-static double
-calculate_inner_product(const vector<double> &parameters, const vector<double> &fvals) {
-    LOGCALL_STATIC_VOID(API, "calculate_inner_product", parameters | fvals);
-    double inner_product = 0.0;
-    for (size_t i = 0; i < fvals.size(); ++i)
-	inner_product += parameters[i] * fvals[i];
-    return inner_product;
-}
-
 // From Theorem (8) in Cao et al. "Learning to rank: from pairwise approach to listwise approach."
-static prob_distrib_vector
-init_probability(const vector<FeatureVector> &feature_vectors, const vector<double> &new_parameters) {
-    LOGCALL_STATIC_VOID(API, "init_probability", feature_vectors | new_parameters);
-
-    // probability distribution, y is ground truth, while z is predict score
-    vector<double> prob_y;
-    vector<double> prob_z;
-    double expsum_y = 0.0;
-    double expsum_z = 0.0;
-
-    for (auto&& v : feature_vectors) {
-	expsum_y += exp(v.get_label());
-	expsum_z += exp(calculate_inner_product(new_parameters, v.get_fvals()));
+//
+// Sets prob to the probability distribution of exp(scores).
+static void
+calculate_probability(const vector<double> &scores, vector<double> &prob) {
+    LOGCALL_STATIC_VOID(API, "calculate_probability", scores);
+    prob.resize(scores.size());
+    double expsum = 0.0;
+    for (size_t i = 0; i < scores.size(); ++i) {
+	prob[i] = exp(scores[i]);
+	expsum += prob[i];
     }
-    for (auto&& v : feature_vectors) {
-	prob_y.push_back(exp(v.get_label()) / expsum_y);
-	prob_z.push_back(exp(calculate_inner_product(new_parameters, v.get_fvals())) / expsum_z);
+    for (auto& p : prob) {
+	p /= expsum;
     }
-    vector<vector<double>> prob;
-    prob.push_back(prob_y);
-    prob.push_back(prob_z);
-    return prob;
 }
 
 // Equation (6) in paper Cao et al. "Learning to rank: from pairwise approach to listwise approach."
-static vector<double>
-calculate_gradient(const vector<FeatureVector> &feature_vectors, const prob_distrib_vector &prob) {
-    LOGCALL_STATIC_VOID(API, "calculate_gradient", feature_vectors | prob);
-
-    vector<double> gradient(feature_vectors[0].get_fcount(), 0);
-
-    // Hold ground truth probability distribution
-    const vector<double> prob_y(prob[0]);
-    // Hold prediction score probability distribution
-    const vector<double> prob_z(prob[1]);
-
-    for (size_t i = 0; i < feature_vectors.size(); ++i) {
-	vector<double> fvals = feature_vectors[i].get_fvals();
-	for (size_t k = 0; k < fvals.size(); ++k) {
-	    double first_term = - prob_y[i] * fvals[k];
-	    gradient[k] += first_term;
-
-	    double second_term = prob_z[i] * fvals[k];
-	    gradient[k] += second_term;
-	}
+static void
+calculate_gradient(const FeatureMatrix &feature_matrix,
+		   const vector<double> &prob_y,
+		   const vector<double> &prob_z,
+		   vector<double> &gradient) {
+    LOGCALL_STATIC_VOID(API, "calculate_gradient", prob_y | prob_z);
+
+    size_t num_features = feature_matrix.columns();
+    gradient.assign(num_features, 0.0);
+    for (size_t i = 0; i < feature_matrix.rows(); ++i) {
+	add_scaled(gradient.data(), feature_matrix.row(i),
+		   prob_z[i] - prob_y[i], num_features);
     }
-    return gradient;
 }
 
 static void
@@ -130,32 +102,41 @@ void
 ListNETRanker::train(const vector<vector<Xapian::FeatureVector>>& training_data)
 {
     LOGCALL_VOID(API, "ListNETRanker::train", training_data);
-    if (training_data.empty() || training_data[0].empty())
-	throw InvalidArgumentError("Cannot train: no training data");
-    int feature_cnt = training_data[0][0].get_fcount();
+    vector<FeatureMatrix> queries = pack_training_data(training_data);
+    size_t feature_cnt = queries[0].columns();
 
     // initialize the parameters for neural network
     vector<double> new_parameters(feature_cnt, 0.0);
 
-    for (auto& item1 : training_data) {
-	for (auto& item2 : item1) {
-	    if (item2.get_fcount() != feature_cnt) {
-		throw InvalidArgumentError("Cannot train: training data has "
-					   "uneven set of features. Make sure "
-					   "that you are using the same set "
-					   "of Features for all the queries");
-	    }
-	}
+    // The probability distribution of the ground truth for each query
+    // doesn't depend on the parameters so only needs computing once.
+    vector<vector<double>> prob_y(queries.size());
+    for (size_t q = 0; q < queries.size(); ++q) {
+	const FeatureMatrix& item = queries[q];
+	vector<double> labels(item.rows());
+	for (size_t i = 0; i < item.rows(); ++i)
+	    labels[i] = item.label(i);
+	calculate_probability(labels, prob_y[q]);
     }
+
+    vector<double> scores, prob_z, gradient;
     // iterations
     for (int iter_num = 1; iter_num <= iterations; ++iter_num) {
-	for (auto& item : training_data) {
-	    // Initialize probability distributions of y and z.
-	    prob_distrib_vector prob = init_probability(item, new_parameters);
+	for (size_t q = 0; q < queries.size(); ++q) {
+	    const FeatureMatrix& item = queries[q];
+	    if (item.rows() == 0)
+		continue;
+	    // Compute the probability distribution of the predicted scores.
+	    scores.resize(item.rows());
+	    for (size_t i = 0; i < item.rows(); ++i) {
+		scores[i] = inner_product(new_parameters.data(), item.row(i),
+					  feature_cnt);
+	    }
+	    calculate_probability(scores, prob_z);
 	    // Compute gradient
-	    vector<double> gradient = calculate_gradient(item, prob);
+	    calculate_gradient(item, prob_y[q], prob_z, gradient);
 	    // Normalize gradient
-	    normalize(gradient, item.size());
+	    normalize(gradient, item.rows());
 	    // Update parameters: w = w - gradient * learningRate
 	    update_parameters(new_parameters, gradient, learning_rate);
 	}
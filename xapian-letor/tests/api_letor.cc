@@ -25,6 +25,7 @@
 
 #include <cstdlib>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 
 #include <xapian.h>
@@ -1445,3 +1446,105 @@ DEFINE_TESTCASE(populatefeature, backend) {
 
     custom_feature->test_stats();
 }
+
+// Small database with query terms before, among and after the title terms.
+static void
+db_index_merge_terms(Xapian::WritableDatabase& db, const string&)
+{
+    Xapian::Document doc;
+    doc.add_term("apple", 2);
+    doc.add_term("Sapple", 3);
+    doc.add_term("Sbanana", 1);
+    doc.add_term("XDapple", 4);
+    doc.add_term("Zapple", 1);
+    db.add_document(doc);
+    doc.clear_terms();
+    doc.add_term("Sbanana", 2);
+    doc.add_term("Scherry", 1);
+    doc.add_term("XDcherry", 1);
+    doc.add_term("cherry", 5);
+    db.add_document(doc);
+    doc.clear_terms();
+    doc.add_term("apple", 1);
+    doc.add_term("Zapple", 2);
+    db.add_document(doc);
+}
+
+static const char* const merge_query_terms[] = {
+    "apple", "cherry", "Sapple", "Sbanana", "Scherry", "Sdurian",
+    "XDapple", "Zapple", "zebra"
+};
+
+/// Feature which records the document statistics it is given.
+class DocStatsFeature : public Xapian::Feature {
+  public:
+    mutable vector<vector<Xapian::termcount>> stats;
+
+    DocStatsFeature() {
+	need_stat(Xapian::Feature::TERM_FREQUENCY);
+	need_stat(Xapian::Feature::DOCUMENT_LENGTH);
+    }
+
+    std::vector<double> get_values() const {
+	vector<Xapian::termcount> s;
+	for (auto term : merge_query_terms) {
+	    s.push_back(get_termfreq(term));
+	}
+	s.push_back(get_doc_length("title"));
+	s.push_back(get_doc_length("body"));
+	s.push_back(get_doc_length("whole"));
+	stats.push_back(s);
+	return vector<double>();
+    }
+
+    std::string name() const {
+	return "DocStatsFeature";
+    }
+};
+
+/// Check the per-document statistics found by merging termlists.
+DEFINE_TESTCASE(featuredocstats1, backend) {
+    XFAIL_FOR_BACKEND("multi", "Testcase fails with multidatabase");
+    Xapian::Database db = get_database("db_index_merge_terms",
+				       db_index_merge_terms);
+    Xapian::Query query(Xapian::Query::OP_OR,
+			begin(merge_query_terms), end(merge_query_terms));
+    Xapian::Enquire enquire(db);
+    enquire.set_query(query);
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 3);
+
+    DocStatsFeature* feature = new DocStatsFeature;
+    Xapian::FeatureList fl({feature});
+    auto fv = fl.create_feature_vectors(mset, query, db);
+    TEST_EQUAL(fv.size(), 3);
+    TEST_EQUAL(feature->stats.size(), 3);
+
+    // Work out what the statistics should be directly from the termlists.
+    size_t n = 0;
+    for (auto i = mset.begin(); i != mset.end(); ++i) {
+	Xapian::Document doc = i.get_document();
+	vector<Xapian::termcount> expected;
+	for (auto term : merge_query_terms) {
+	    Xapian::termcount wdf = 0;
+	    for (auto t = doc.termlist_begin(); t != doc.termlist_end(); ++t) {
+		if (*t == term) wdf = t.get_wdf();
+	    }
+	    expected.push_back(wdf);
+	}
+	Xapian::termcount title_len = 0, whole_len = 0;
+	for (auto t = doc.termlist_begin(); t != doc.termlist_end(); ++t) {
+	    if ((*t)[0] == 'S') title_len += t.get_wdf();
+	    whole_len += t.get_wdf();
+	}
+	expected.push_back(title_len);
+	expected.push_back(whole_len - title_len);
+	expected.push_back(whole_len);
+	const auto& stats = feature->stats[n++];
+	TEST_EQUAL(stats.size(), expected.size());
+	for (size_t j = 0; j != expected.size(); ++j) {
+	    tout << "doc " << *i << " stat " << j << '\n';
+	    TEST_EQUAL(stats[j], expected[j]);
+	}
+    }
+}